@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+
+#include "corpus.h"
+
+#include "../src/lib/reader.h"
+#include "../src/lib/writer.h"
+
+namespace {
+
+const size_t BIT_IO_SIZE = 1 << 20;
+
+// The field width is the argument, data is random so that no width is special
+void BM_ReaderReadBits(benchmark::State &state) {
+    const size_t width = static_cast<size_t>(state.range(0));
+    const std::vector<char> data = MakeCorpus(Corpus::Random, BIT_IO_SIZE);
+    const size_t reads_count = data.size() * CHAR_BIT / width;
+    for (auto _ : state) {
+        state.PauseTiming();
+        Reader reader(data);
+        state.ResumeTiming();
+        uint64_t sum = 0;
+        for (size_t i = 0; i < reads_count; ++i) {
+            sum += reader.ReadBits<uint64_t>(width);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+BENCHMARK(BM_ReaderReadBits)->Arg(1)->Arg(9)->Arg(13)->Arg(32)->Arg(57);
+
+void BM_WriterWriteBits(benchmark::State &state) {
+    const size_t width = static_cast<size_t>(state.range(0));
+    const std::vector<char> data = MakeCorpus(Corpus::Random, BIT_IO_SIZE);
+    std::vector<uint64_t> values(data.size() * CHAR_BIT / width);
+    {
+        Reader reader(data);
+        for (auto &value : values) {
+            value = reader.ReadBits<uint64_t>(width);
+        }
+    }
+    std::vector<char> output;
+    output.reserve(data.size());
+    for (auto _ : state) {
+        output.clear();
+        {
+            Writer writer(output);
+            for (uint64_t value : values) {
+                writer.WriteBits(value, width);
+            }
+        }
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+BENCHMARK(BM_WriterWriteBits)->Arg(1)->Arg(9)->Arg(13)->Arg(32)->Arg(57);
+
+}  // namespace
@@ -0,0 +1,122 @@
+#include <benchmark/benchmark.h>
+
+#include "corpus.h"
+
+#include "../src/code_lengths.h"
+#include "../src/decode_table.h"
+#include "../src/huffman_constants.h"
+#include "../src/lib/histogram.h"
+#include "../src/lib/queue_increasing.h"
+#include "../src/lib/trie.h"
+
+namespace {
+
+using CanonicalOrder = std::vector<std::pair<size_t, huffman::DEFAULT_CHAR_TYPE>>;
+
+const size_t CODE_BUILD_SIZE = 1 << 20;
+
+// Occurrences of the bytes of a corpus and of the three service symbols, as for a legacy archive member
+CanonicalOrder CorpusOccurrences(Corpus corpus) {
+    const std::vector<char> data = MakeCorpus(corpus, CODE_BUILD_SIZE);
+    ByteHistogram histogram = {};
+    CountBytes(data.data(), data.size(), histogram);
+    CanonicalOrder occurrences;
+    for (size_t value = 0; value < histogram.size(); ++value) {
+        if (histogram[value] != 0) {
+            occurrences.emplace_back(histogram[value], static_cast<huffman::DEFAULT_CHAR_TYPE>(value));
+        }
+    }
+    for (auto symbol : {huffman::FILENAME_END, huffman::ONE_MORE_FILE, huffman::ARCHIVE_END}) {
+        occurrences.emplace_back(1, symbol);
+    }
+    return occurrences;
+}
+
+// Code tables are built per member or block, so these count tables, not bytes
+void BM_HuffmanCodeLengths(benchmark::State &state) {
+    const CanonicalOrder occurrences = CorpusOccurrences(GetCorpus(state));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(HuffmanCodeLengths(occurrences));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(CorpusName(GetCorpus(state)));
+}
+BENCHMARK(BM_HuffmanCodeLengths)->Apply(ForAllCorpora);
+
+void BM_LimitedCodeLengths(benchmark::State &state) {
+    const CanonicalOrder occurrences = CorpusOccurrences(GetCorpus(state));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(LimitedCodeLengths(occurrences, huffman::MIN_CODE_LENGTH_LIMIT));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(CorpusName(GetCorpus(state)));
+}
+BENCHMARK(BM_LimitedCodeLengths)->Apply(ForAllCorpora);
+
+void BM_DecodeTableBuild(benchmark::State &state) {
+    const CanonicalOrder canonical_order = HuffmanCodeLengths(CorpusOccurrences(GetCorpus(state)));
+    for (auto _ : state) {
+        DecodeTable<huffman::DEFAULT_CHAR_TYPE> table(canonical_order);
+        benchmark::DoNotOptimize(table);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(CorpusName(GetCorpus(state)));
+}
+BENCHMARK(BM_DecodeTableBuild)->Apply(ForAllCorpora);
+
+// Merges the leaves of a Huffman tree the way the tree was built before code_lengths.h
+void BM_QueueTwoIncreasing(benchmark::State &state) {
+    CanonicalOrder occurrences = CorpusOccurrences(GetCorpus(state));
+    std::sort(occurrences.begin(), occurrences.end());
+    for (auto _ : state) {
+        QueueTwoIncreasing<std::pair<size_t, huffman::DEFAULT_CHAR_TYPE>> queue;
+        for (const auto &leaf : occurrences) {
+            queue.Push(leaf);
+        }
+        while (queue.Size() > 1) {
+            const auto first = queue.ExtractMin();
+            const auto second = queue.ExtractMin();
+            queue.Push({first.first + second.first, std::min(first.second, second.second)});
+        }
+        benchmark::DoNotOptimize(queue.Top());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * occurrences.size()));
+    state.SetLabel(CorpusName(GetCorpus(state)));
+}
+BENCHMARK(BM_QueueTwoIncreasing)->Apply(ForAllCorpora);
+
+// Decodes the corpus bit by bit through a trie of its canonical codes
+void BM_TrieTraverseOnce(benchmark::State &state) {
+    const std::vector<char> data = MakeCorpus(GetCorpus(state), CODE_BUILD_SIZE);
+    const CanonicalOrder canonical_order = HuffmanCodeLengths(CorpusOccurrences(GetCorpus(state)));
+    const std::vector<uint64_t> codes = CanonicalCodes(canonical_order);
+    Trie<huffman::DEFAULT_CHAR_TYPE, 2> trie;
+    std::vector<std::vector<size_t>> paths(size_t{1} << huffman::DEFAULT_OUT_CHAR_SIZE);
+    for (size_t i = 0; i < canonical_order.size(); ++i) {
+        const auto &[code_length, character] = canonical_order[i];
+        for (size_t bit = code_length; bit-- > 0;) {
+            paths[character].push_back((codes[i] >> bit) & 1);
+        }
+        trie.Insert(paths[character], character);
+    }
+    std::vector<size_t> bits;
+    for (char value : data) {
+        const auto &path = paths[static_cast<unsigned char>(value)];
+        bits.insert(bits.end(), path.begin(), path.end());
+    }
+
+    for (auto _ : state) {
+        size_t next_bit = 0;
+        auto get_next = [&]() { return bits[next_bit++]; };
+        uint64_t sum = 0;
+        for (size_t i = 0; i < data.size(); ++i) {
+            sum += *trie.TraverseOnce(get_next);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+    state.SetLabel(CorpusName(GetCorpus(state)));
+}
+BENCHMARK(BM_TrieTraverseOnce)->Apply(ForAllCorpora);
+
+}  // namespace
@@ -0,0 +1,141 @@
+#include <benchmark/benchmark.h>
+
+#include "corpus.h"
+
+#include "../src/huffman_code.h"
+
+#include <filesystem>
+
+namespace {
+
+const size_t CODING_SIZE = 4 << 20;
+
+std::vector<char> EncodeLegacy(const std::vector<char> &data) {
+    std::vector<char> archive;
+    {
+        Reader reader(data);
+        Writer writer(archive);
+        HuffmanEncoder encoder;
+        encoder.EncodeFile(reader, writer);
+    }
+    return archive;
+}
+
+// Block archives are made of files, the corpus is written to a temporary one
+class BlockArchiveFixture : public benchmark::Fixture {
+public:
+    void SetUp(const benchmark::State &state) override {
+        data = MakeCorpus(GetCorpus(state), CODING_SIZE);
+        file_name = (std::filesystem::temp_directory_path() / ("bench_archiver_" + CorpusName(GetCorpus(state))))
+                        .string();
+        Writer writer(file_name);
+        writer.WriteBytes(data.data(), data.size());
+    }
+
+    void TearDown(const benchmark::State &) override {
+        std::filesystem::remove(file_name);
+    }
+
+    std::vector<char> Encode(huffman::EncoderOptions options) const {
+        std::vector<char> archive;
+        {
+            Writer writer(archive);
+            HuffmanEncoder encoder(options);
+            encoder.EncodeFiles({file_name}, writer);
+        }
+        return archive;
+    }
+
+    std::vector<char> data;
+    std::string file_name;
+};
+
+huffman::EncoderOptions BlockOptions(const benchmark::State &state) {
+    huffman::EncoderOptions options;
+    options.block_size = huffman::block::DEFAULT_BLOCK_SIZE;
+    options.streams_count = static_cast<size_t>(state.range(1));
+    return options;
+}
+
+// A decoder that fails or decodes something else must not produce numbers
+bool DecodeInto(const std::vector<char> &archive, std::vector<char> &output, benchmark::State &state) {
+    output.clear();
+    Reader reader(archive);
+    bool is_decoded;
+    {
+        Writer writer(output);
+        HuffmanDecoder decoder;
+        is_decoded = decoder.Decode(reader, &writer);
+    }
+    if (!is_decoded) {
+        state.SkipWithError("Decode failed");
+    }
+    return is_decoded;
+}
+
+// Block benchmarks take the corpus and the number of streams
+void ForAllCorporaAndStreams(benchmark::internal::Benchmark *benchmark) {
+    for (Corpus corpus : ALL_CORPORA) {
+        for (int64_t streams_count : {int64_t{1}, static_cast<int64_t>(huffman::block::STREAMS_COUNT)}) {
+            benchmark->Args({static_cast<int64_t>(corpus), streams_count});
+        }
+    }
+}
+
+void BM_EncodeLegacy(benchmark::State &state) {
+    const std::vector<char> data = MakeCorpus(GetCorpus(state), CODING_SIZE);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(EncodeLegacy(data));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+    state.SetLabel(CorpusName(GetCorpus(state)));
+}
+BENCHMARK(BM_EncodeLegacy)->Apply(ForAllCorpora);
+
+void BM_DecodeLegacy(benchmark::State &state) {
+    const std::vector<char> data = MakeCorpus(GetCorpus(state), CODING_SIZE);
+    const std::vector<char> archive = EncodeLegacy(data);
+    std::vector<char> output;
+    output.reserve(data.size());
+    for (auto _ : state) {
+        if (!DecodeInto(archive, output, state)) {
+            break;
+        }
+        benchmark::DoNotOptimize(output.data());
+    }
+    if (output != data) {
+        state.SkipWithError("Decoded data differs from the corpus");
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+    state.SetLabel(CorpusName(GetCorpus(state)));
+}
+BENCHMARK(BM_DecodeLegacy)->Apply(ForAllCorpora);
+
+BENCHMARK_DEFINE_F(BlockArchiveFixture, BM_EncodeBlocks)(benchmark::State &state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Encode(BlockOptions(state)));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+    state.SetLabel(CorpusName(GetCorpus(state)));
+}
+BENCHMARK_REGISTER_F(BlockArchiveFixture, BM_EncodeBlocks)->Apply(ForAllCorporaAndStreams);
+
+BENCHMARK_DEFINE_F(BlockArchiveFixture, BM_DecodeBlocks)(benchmark::State &state) {
+    const std::vector<char> archive = Encode(BlockOptions(state));
+    std::vector<char> output;
+    output.reserve(data.size());
+    for (auto _ : state) {
+        if (!DecodeInto(archive, output, state)) {
+            break;
+        }
+        benchmark::DoNotOptimize(output.data());
+    }
+    if (output != data) {
+        state.SkipWithError("Decoded data differs from the corpus");
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+    state.SetLabel(CorpusName(GetCorpus(state)));
+}
+BENCHMARK_REGISTER_F(BlockArchiveFixture, BM_DecodeBlocks)->Apply(ForAllCorporaAndStreams);
+
+}  // namespace
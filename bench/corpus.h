@@ -0,0 +1,90 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Generated inputs, the same for every run and version so that results can be compared:
+//   uniform - 32 byte values, equally likely, so every code has the same length
+//   skewed  - geometrically distributed byte values, a few of them take most of the data
+//   text    - words of a Zipf-distributed vocabulary with spaces, punctuation and line breaks
+//   random  - independent random bytes that no code shrinks
+enum class Corpus { Uniform, Skewed, Text, Random };
+
+inline const std::vector<Corpus> ALL_CORPORA = {Corpus::Uniform, Corpus::Skewed, Corpus::Text, Corpus::Random};
+
+inline std::string CorpusName(Corpus corpus) {
+    switch (corpus) {
+        case Corpus::Uniform:
+            return "uniform";
+        case Corpus::Skewed:
+            return "skewed";
+        case Corpus::Text:
+            return "text";
+        case Corpus::Random:
+            return "random";
+    }
+    return "";
+}
+
+inline std::vector<char> MakeCorpus(Corpus corpus, size_t size) {
+    std::mt19937_64 generator(size);
+    std::vector<char> data;
+    data.reserve(size);
+    if (corpus == Corpus::Text) {
+        std::vector<std::string> vocabulary(2000);
+        std::uniform_int_distribution<size_t> word_length(1, 10);
+        std::uniform_int_distribution<int> letter('a', 'z');
+        for (auto &word : vocabulary) {
+            word.resize(word_length(generator));
+            for (auto &ch : word) {
+                ch = static_cast<char>(letter(generator));
+            }
+        }
+        std::vector<double> weights(vocabulary.size());
+        for (size_t i = 0; i < weights.size(); ++i) {
+            weights[i] = 1.0 / static_cast<double>(i + 1);
+        }
+        std::discrete_distribution<size_t> word(weights.begin(), weights.end());
+        std::uniform_int_distribution<int> separator(0, 15);
+        while (data.size() < size) {
+            const std::string &next = vocabulary[word(generator)];
+            data.insert(data.end(), next.begin(), next.end());
+            const int kind = separator(generator);
+            data.push_back(kind == 0 ? '\n' : kind == 1 ? ',' : kind == 2 ? '.' : ' ');
+        }
+        data.resize(size);
+        return data;
+    }
+    std::uniform_int_distribution<int> uniform(0, 31);
+    std::geometric_distribution<int> skewed(0.2);
+    std::uniform_int_distribution<int> random(0, 255);
+    for (size_t i = 0; i < size; ++i) {
+        int value = 0;
+        if (corpus == Corpus::Uniform) {
+            value = 'A' + uniform(generator);
+        } else if (corpus == Corpus::Skewed) {
+            value = std::min(skewed(generator), 255);
+        } else {
+            value = random(generator);
+        }
+        data.push_back(static_cast<char>(value));
+    }
+    return data;
+}
+
+// Runs a benchmark once for every corpus, the corpus is its first argument
+inline void ForAllCorpora(benchmark::internal::Benchmark *benchmark) {
+    for (Corpus corpus : ALL_CORPORA) {
+        benchmark->Arg(static_cast<int64_t>(corpus));
+    }
+}
+
+inline Corpus GetCorpus(const benchmark::State &state) {
+    return static_cast<Corpus>(state.range(0));
+}
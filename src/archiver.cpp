@@ -1,17 +1,84 @@
+#include <chrono>
 #include <iostream>
+#include <optional>
 
 #include "huffman_code.h"
 #include "lib/cla_parser.h"
 
+namespace {
+
+const size_t MAX_BUFFER_SIZE = size_t{1} << 30;
+
+}  // namespace
+
 int main(int argc, char **argv) {
     try {
         CLAParser parser;
         parser.AddFlag('c', "compress",
                        "using: -c archive file1 file2...\n"
-                       "    Compress files file1, file2, ... to archive");
+                       "    Compress files file1, file2, ... to archive, - stands for the standard input or output");
         parser.AddFlag('d', "decompress",
-                       "using: -d archive\n"
-                       "    Decompress archive");
+                       "using: -d archive [-]\n"
+                       "    Decompress archive, or write the contents of all files to the standard output with -");
+        parser.AddFlag('x', "extract",
+                       "using: -x archive file1 file2...\n"
+                       "    Decompress only files file1, file2, ... from archive");
+        parser.AddFlag('t', "test",
+                       "using: -t archive\n"
+                       "    Check that archive decompresses and matches its checksums without writing anything");
+        parser.AddFlag('T', "train",
+                       "using: -T dictionary file1 file2...\n"
+                       "    Build a dictionary of Huffman codes for small files like file1, file2, ...");
+        parser.AddFlag('l', "list",
+                       "using: -l archive\n"
+                       "    List sizes and names of files in archive");
+        parser.AddArgument<int>('m', "max-code-len", "[INT]",
+                                "using: -c archive file1... --max-code-len N\n"
+                                "    Limit Huffman codes to N bits (9..57), no limit by default",
+                                false);
+        parser.AddArgument<int>('b', "block-size", "[INT]",
+                                "using: -c archive file1... --block-size N\n"
+                                "    Write a block archive with a separate Huffman table for every N KiB",
+                                false);
+        parser.AddArgument<int>('j', "threads", "[INT]",
+                                "using: -c archive file1... -j N, -d archive -j N or -x archive file1... -j N\n"
+                                "    Compress blocks (or files of a legacy archive) or decompress blocks on N threads",
+                                false);
+        parser.AddArgument<int>('s', "streams", "[INT]",
+                                "using: -c archive file1... --streams N\n"
+                                "    Code every block in N (1 or 4) interleaved streams for faster decompression",
+                                false);
+        parser.AddArgument<std::string>('e', "entropy", "[STRING]",
+                                        "using: -c archive file1... --entropy huffman|tans|smallest\n"
+                                        "    Code blocks with Huffman codes, with tANS or with whichever is shorter",
+                                        false);
+        parser.AddArgument<int>('z', "lz", "[INT]",
+                                "using: -c archive file1... --lz N\n"
+                                "    Replace repeated strings with references before Huffman coding, looking at up to\n"
+                                "    N (1..65536) earlier candidates for every string",
+                                false);
+        parser.AddFlag('u', "dedup",
+                       "using: -c archive file1... --dedup\n"
+                       "    Store files with the same contents as an earlier file as its copies. Decompressing\n"
+                       "    such copies to the standard output needs an archive that is not a pipe");
+        parser.AddArgument<std::string>('D', "dictionary", "[STRING]",
+                                        "using: -c archive file1... --dictionary FILE or -d archive --dictionary FILE\n"
+                                        "    Code all blocks with the codes of a dictionary built with -T instead of a\n"
+                                        "    table for every block. The dictionary is stored in the archive once",
+                                        false);
+        parser.AddFlag('k', "link-dictionary",
+                       "using: -c archive file1... --dictionary FILE --link-dictionary\n"
+                       "    Only refer to the dictionary, the same FILE is then needed to decompress the archive");
+        parser.AddArgument<int>('B', "buffer-size", "[INT]",
+                                "using: -c archive file1... --buffer-size N, also with -d, -x, -t or -l\n"
+                                "    Read and write archives and files through buffers of N KiB, 1024 by default.\n"
+                                "    Full buffers are written in the background while the next one is filled",
+                                false);
+        parser.AddArgument<std::string>('S', "stats", "[STRING]",
+                                        "using: -c archive file1... --stats text|json, also with -d, -x or -t\n"
+                                        "    Print sizes, counters and phase times for every file and in total to the\n"
+                                        "    standard error",
+                                        false);
         parser.AddFlag('h', "help",
                        "using: -h\n"
                        "    Help information");
@@ -31,43 +98,255 @@ int main(int argc, char **argv) {
 
         bool compress_mode = *parser.GetArgumentValue<bool>("compress");
         bool decompress_mode = *parser.GetArgumentValue<bool>("decompress");
+        bool extract_mode = *parser.GetArgumentValue<bool>("extract");
+        bool list_mode = *parser.GetArgumentValue<bool>("list");
+        bool test_mode = *parser.GetArgumentValue<bool>("test");
+        bool train_mode = *parser.GetArgumentValue<bool>("train");
 
-        if (compress_mode == decompress_mode) {
+        if (compress_mode + decompress_mode + extract_mode + list_mode + test_mode + train_mode != 1) {
             std::cerr << parser.GetHelp() << std::endl;
-            std::cerr << "Choose compress or decompress mode" << std::endl;
+            std::cerr << "Choose compress, decompress, extract, list, test or train mode" << std::endl;
             return 111;
         }
+        size_t threads_count = 1;
+        if (const int *threads = parser.GetArgumentValue<int>("threads")) {
+            if (*threads <= 0) {
+                std::cerr << parser.GetHelp() << std::endl;
+                std::cerr << "Number of threads must be positive" << std::endl;
+                return 111;
+            }
+            threads_count = static_cast<size_t>(*threads);
+        }
+        size_t buffer_size = Writer::DEFAULT_FILE_BUFFER_BYTE_SIZE;
+        if (const int *buffer_kib = parser.GetArgumentValue<int>("buffer-size")) {
+            if (*buffer_kib <= 0 || static_cast<size_t>(*buffer_kib) > MAX_BUFFER_SIZE / 1024) {
+                std::cerr << parser.GetHelp() << std::endl;
+                std::cerr << "Buffer size must be between 1 and " << MAX_BUFFER_SIZE / 1024 << " KiB" << std::endl;
+                return 111;
+            }
+            buffer_size = static_cast<size_t>(*buffer_kib) * 1024;
+        }
+        std::optional<Stats> stats;
+        bool is_stats_json = false;
+        if (const std::string *stats_format = parser.GetArgumentValue<std::string>("stats")) {
+            if (*stats_format != "text" && *stats_format != "json") {
+                std::cerr << parser.GetHelp() << std::endl;
+                std::cerr << "Stats format must be text or json" << std::endl;
+                return 111;
+            }
+            if (!Stats::IS_COMPILED) {
+                std::cerr << "The archiver is built without stats" << std::endl;
+                return 111;
+            }
+            stats.emplace();
+            is_stats_json = *stats_format == "json";
+        }
+        Stats *const stats_ptr = stats ? &*stats : nullptr;
+        const auto start_time = std::chrono::steady_clock::now();
+        std::vector<char> dictionary;
+        if (const std::string *dictionary_name = parser.GetArgumentValue<std::string>("dictionary")) {
+            Reader dictionary_reader(*dictionary_name);
+            dictionary = huffman::dictionary::ReadTable(dictionary_reader);
+        }
         if (compress_mode) {
             if (parser.GetMultiplyArgumentsNumber<std::string>() <= 1) {
                 std::cerr << parser.GetHelp() << std::endl;
                 std::cerr << "Nothing to compress" << std::endl;
                 return 111;
             }
-            Writer writer(*parser.GetMultiplyArgumentValue<std::string>(0));
+            huffman::EncoderOptions options;
+            if (const int *max_code_length = parser.GetArgumentValue<int>("max-code-len")) {
+                if (*max_code_length < static_cast<int>(huffman::MIN_CODE_LENGTH_LIMIT) ||
+                    *max_code_length > static_cast<int>(huffman::MAX_CODE_LENGTH_LIMIT)) {
+                    std::cerr << parser.GetHelp() << std::endl;
+                    std::cerr << "Maximum code length must be between " << huffman::MIN_CODE_LENGTH_LIMIT << " and "
+                              << huffman::MAX_CODE_LENGTH_LIMIT << std::endl;
+                    return 111;
+                }
+                options.max_code_length = *max_code_length;
+            }
+            if (const int *block_size = parser.GetArgumentValue<int>("block-size")) {
+                if (*block_size <= 0 || static_cast<size_t>(*block_size) > huffman::block::MAX_BLOCK_SIZE / 1024) {
+                    std::cerr << parser.GetHelp() << std::endl;
+                    std::cerr << "Block size must be between 1 and " << huffman::block::MAX_BLOCK_SIZE / 1024 << " KiB"
+                              << std::endl;
+                    return 111;
+                }
+                options.block_size = static_cast<size_t>(*block_size) * 1024;
+            }
+            if (const int *streams = parser.GetArgumentValue<int>("streams")) {
+                if (*streams != 1 && *streams != static_cast<int>(huffman::block::STREAMS_COUNT)) {
+                    std::cerr << parser.GetHelp() << std::endl;
+                    std::cerr << "Number of streams must be 1 or " << huffman::block::STREAMS_COUNT << std::endl;
+                    return 111;
+                }
+                options.streams_count = static_cast<size_t>(*streams);
+            }
+            if (const std::string *entropy = parser.GetArgumentValue<std::string>("entropy")) {
+                if (*entropy == "huffman") {
+                    options.entropy_coder = huffman::EntropyCoder::Huffman;
+                } else if (*entropy == "tans") {
+                    options.entropy_coder = huffman::EntropyCoder::Tans;
+                } else if (*entropy == "smallest") {
+                    options.entropy_coder = huffman::EntropyCoder::Smallest;
+                } else {
+                    std::cerr << parser.GetHelp() << std::endl;
+                    std::cerr << "Entropy coder must be huffman, tans or smallest" << std::endl;
+                    return 111;
+                }
+                if (options.entropy_coder == huffman::EntropyCoder::Tans && options.streams_count > 1) {
+                    std::cerr << parser.GetHelp() << std::endl;
+                    std::cerr << "Only Huffman codes can be split into streams" << std::endl;
+                    return 111;
+                }
+            }
+            if (const int *lz_search_depth = parser.GetArgumentValue<int>("lz")) {
+                if (*lz_search_depth <= 0 || *lz_search_depth > static_cast<int>(huffman::MAX_LZ_SEARCH_DEPTH)) {
+                    std::cerr << parser.GetHelp() << std::endl;
+                    std::cerr << "LZ77 search depth must be between 1 and " << huffman::MAX_LZ_SEARCH_DEPTH << std::endl;
+                    return 111;
+                }
+                if (options.entropy_coder == huffman::EntropyCoder::Tans || options.streams_count > 1) {
+                    std::cerr << parser.GetHelp() << std::endl;
+                    std::cerr << "LZ77 only goes with Huffman codes in a single stream" << std::endl;
+                    return 111;
+                }
+                options.lz_search_depth = static_cast<size_t>(*lz_search_depth);
+            }
+            options.deduplicate = *parser.GetArgumentValue<bool>("dedup");
+            if (!dictionary.empty() && (options.entropy_coder != huffman::EntropyCoder::Huffman ||
+                                        options.streams_count > 1 || options.lz_search_depth != 0)) {
+                std::cerr << parser.GetHelp() << std::endl;
+                std::cerr << "The dictionary only goes with Huffman codes in a single stream without LZ77" << std::endl;
+                return 111;
+            }
+            options.link_dictionary = *parser.GetArgumentValue<bool>("link-dictionary");
+            if (options.link_dictionary && dictionary.empty()) {
+                std::cerr << parser.GetHelp() << std::endl;
+                std::cerr << "Nothing to link, please, give the dictionary" << std::endl;
+                return 111;
+            }
+            options.dictionary = std::move(dictionary);
+            options.threads_count = threads_count;
+            options.stats = stats_ptr;
+            options.buffer_size = buffer_size;
+            Writer writer(*parser.GetMultiplyArgumentValue<std::string>(0), buffer_size);
             std::vector<std::string> file_names(parser.GetMultiplyArgumentsNumber<std::string>() - 1);
             for (size_t i = 0; i < file_names.size(); ++i) {
                 file_names[i] = *parser.GetMultiplyArgumentValue<std::string>(i + 1);
             }
-            HuffmanEncoder encoder;
+            HuffmanEncoder encoder(options);
             encoder.EncodeFiles(file_names, writer);
-        } else {
+        } else if (decompress_mode) {
             if (parser.GetMultiplyArgumentsNumber<std::string>() < 1) {
                 std::cerr << parser.GetHelp() << std::endl;
                 std::cerr << "Nothing to decompress" << std::endl;
                 return 111;
             }
-            if (parser.GetMultiplyArgumentsNumber<std::string>() > 1) {
+            if (parser.GetMultiplyArgumentsNumber<std::string>() > 2 ||
+                (parser.GetMultiplyArgumentsNumber<std::string>() == 2 &&
+                 *parser.GetMultiplyArgumentValue<std::string>(1) != Writer::STANDARD_OUTPUT_NAME)) {
                 std::cerr << parser.GetHelp() << std::endl;
                 std::cerr << "Too many files to decompress, please, use only 1" << std::endl;
                 return 111;
             }
-            Reader reader(*parser.GetMultiplyArgumentValue<std::string>(0));
+            Reader reader(*parser.GetMultiplyArgumentValue<std::string>(0), buffer_size);
+            std::optional<Writer> output;
+            if (parser.GetMultiplyArgumentsNumber<std::string>() == 2) {
+                output.emplace(Writer::STANDARD_OUTPUT_NAME, buffer_size);
+            }
+            HuffmanDecoder decoder(
+                {.threads_count = threads_count,
+                 .dictionary = std::move(dictionary),
+                 .stats = stats_ptr,
+                 .buffer_size = buffer_size});
+            if (!decoder.Decode(reader, output ? &*output : nullptr)) {
+                std::cerr << "Decode failed" << std::endl;
+                return 111;
+            }
+        } else if (extract_mode) {
+            if (parser.GetMultiplyArgumentsNumber<std::string>() <= 1) {
+                std::cerr << parser.GetHelp() << std::endl;
+                std::cerr << "Nothing to extract" << std::endl;
+                return 111;
+            }
+            std::vector<std::string> file_names(parser.GetMultiplyArgumentsNumber<std::string>() - 1);
+            for (size_t i = 0; i < file_names.size(); ++i) {
+                file_names[i] = *parser.GetMultiplyArgumentValue<std::string>(i + 1);
+            }
+            Reader reader(*parser.GetMultiplyArgumentValue<std::string>(0), buffer_size);
+            HuffmanDecoder decoder(
+                {.threads_count = threads_count,
+                 .dictionary = std::move(dictionary),
+                 .stats = stats_ptr,
+                 .buffer_size = buffer_size});
+            try {
+                if (!decoder.Extract(reader, file_names)) {
+                    std::cerr << "Decode failed" << std::endl;
+                    return 111;
+                }
+            } catch (const HuffmanDecoder<>::MissingFileException &e) {
+                std::cerr << "No such file in archive: " << e.file_name << std::endl;
+                return 111;
+            }
+        } else if (test_mode) {
+            if (parser.GetMultiplyArgumentsNumber<std::string>() != 1) {
+                std::cerr << parser.GetHelp() << std::endl;
+                std::cerr << "Please, test exactly 1 archive" << std::endl;
+                return 111;
+            }
+            Reader reader(*parser.GetMultiplyArgumentValue<std::string>(0), buffer_size);
+            HuffmanDecoder decoder(
+                {.threads_count = threads_count,
+                 .dictionary = std::move(dictionary),
+                 .stats = stats_ptr,
+                 .buffer_size = buffer_size});
+            if (!decoder.Verify(reader)) {
+                std::cerr << "Archive is damaged" << std::endl;
+                return 111;
+            }
+        } else if (train_mode) {
+            if (parser.GetMultiplyArgumentsNumber<std::string>() <= 1) {
+                std::cerr << parser.GetHelp() << std::endl;
+                std::cerr << "Nothing to train on" << std::endl;
+                return 111;
+            }
+            std::vector<std::string> file_names(parser.GetMultiplyArgumentsNumber<std::string>() - 1);
+            for (size_t i = 0; i < file_names.size(); ++i) {
+                file_names[i] = *parser.GetMultiplyArgumentValue<std::string>(i + 1);
+            }
+            HuffmanEncoder encoder;
+            const std::vector<char> table = encoder.TrainDictionary(file_names);
+            Writer writer(*parser.GetMultiplyArgumentValue<std::string>(0), buffer_size);
+            huffman::dictionary::WriteTable(table, writer);
+        } else {
+            if (parser.GetMultiplyArgumentsNumber<std::string>() != 1) {
+                std::cerr << parser.GetHelp() << std::endl;
+                std::cerr << "Please, list exactly 1 archive" << std::endl;
+                return 111;
+            }
+            Reader reader(*parser.GetMultiplyArgumentValue<std::string>(0), buffer_size);
             HuffmanDecoder decoder;
-            if (!decoder.Decode(reader)) {
+            std::vector<huffman::block::DirectoryEntry> entries;
+            if (!decoder.List(reader, entries)) {
                 std::cerr << "Decode failed" << std::endl;
                 return 111;
             }
+            for (const auto &entry : entries) {
+                std::cout << entry.raw_size << '\t' << entry.name << '\n';
+            }
+        }
+        if (stats) {
+            const auto wall_time = std::chrono::steady_clock::now() - start_time;
+            if (is_stats_json) {
+                stats->PrintJson(std::cerr, wall_time);
+            } else {
+                stats->PrintText(std::cerr, wall_time);
+            }
         }
+    } catch (const HuffmanDecoder<>::MissingDictionaryException &e) {
+        std::cerr << "The archive needs its dictionary, please, give it with --dictionary" << std::endl;
+        return 111;
     } catch (const Reader::FileReadError &e) {
         std::cerr << "Incorrect file data" << std::endl;
         return 111;
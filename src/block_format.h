@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <limits.h>
+
+// Block archive layout, all fields are big-endian and byte aligned:
+//
+//   archive   := MAGIC VERSION block_size:32 dictionary member* ARCHIVE_END directory footer
+//   dictionary := NO_DICTIONARY | EMBEDDED_DICTIONARY table_size:32 table | LINKED_DICTIONARY checksum:32
+//   member    := MEMBER name_length:16 name block* MEMBER_END | MEMBER_COPY name_length:16 name source:32
+//   block     := codec:8 raw_size:32 payload_size:32 checksum:32 payload
+//   directory := members_count:32 entry*
+//   entry     := name_length:16 name raw_size:64 offset:64 checksum:32
+//   footer    := directory_offset:64 MAGIC
+//
+// A member copy has the same data as the MEMBER with the number source in archive order, counting copies.
+// The source has another name, and no member between them has its name.
+// A Huffman payload is the canonical table in the same layout as in the legacy format followed by
+// raw_size codes, padded with zero bits to a whole byte. A 4-stream Huffman payload is the table padded
+// to a whole byte, the byte sizes of the first three streams (32 bits each) and four streams that code
+// consecutive quarters of the block the same way, so that they can be decoded in parallel. A tANS payload
+// is laid out as described in tans_coder.h, padded to a whole byte. An LZ77 Huffman payload is a table
+// of bytes and match length codes (256 + code), a table of match distance codes, and then the code of every
+// byte outside matches and, for every match, the length code, its extra bits, the distance code and
+// its extra bits (see lz77.h), padded to a whole byte. A stored payload is the block as it is.
+// A dictionary payload is only the codes of the block in the table of the archive dictionary, padded to
+// a whole byte. The table is in the legacy layout padded to a whole byte, as in a dictionary file (see
+// dictionary.h); a linked dictionary is not in the archive and is identified by the CRC-32C of its table.
+// Directory entries follow the members in order, offset is the position of the MEMBER tag and checksum
+// is the CRC-32C of the member data, as the checksum of a block is of the block data. Version 1 archives
+// end right after ARCHIVE_END, versions before 3 have no member copies, versions before 4 have no
+// block checksums and versions before 5 have no dictionary field.
+namespace huffman::block {
+
+inline const uint32_t MAGIC = 0xFF484142;  // "\xFFHAB", the first byte of a legacy archive is at most 129
+inline const size_t MAGIC_SIZE = 32;
+inline const uint8_t VERSION = 5;
+inline const uint8_t FIRST_DIRECTORY_VERSION = 2;
+inline const uint8_t FIRST_BLOCK_CHECKSUM_VERSION = 4;
+inline const uint8_t FIRST_DICTIONARY_VERSION = 5;
+
+inline const size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+inline const size_t MAX_BLOCK_SIZE = 1 << 30;
+
+inline const uint8_t ARCHIVE_END = 0;
+inline const uint8_t MEMBER = 1;
+inline const uint8_t MEMBER_COPY = 2;
+
+inline const uint8_t MEMBER_END = 0;
+inline const uint8_t CODEC_HUFFMAN = 1;
+inline const uint8_t CODEC_HUFFMAN_4_STREAMS = 2;
+inline const uint8_t CODEC_TANS = 3;
+inline const uint8_t CODEC_LZ_HUFFMAN = 4;
+inline const uint8_t CODEC_STORED = 5;
+inline const uint8_t CODEC_DICTIONARY_HUFFMAN = 6;
+
+inline const uint8_t NO_DICTIONARY = 0;
+inline const uint8_t EMBEDDED_DICTIONARY = 1;
+inline const uint8_t LINKED_DICTIONARY = 2;
+
+inline const size_t STREAMS_COUNT = 4;
+
+inline const size_t TAG_SIZE = CHAR_BIT;
+inline const size_t VERSION_SIZE = CHAR_BIT;
+inline const size_t CODEC_SIZE = CHAR_BIT;
+inline const size_t DICTIONARY_KIND_SIZE = CHAR_BIT;
+inline const size_t NAME_LENGTH_SIZE = 16;
+inline const size_t SIZE_FIELD_SIZE = 32;
+inline const size_t COUNT_SIZE = 32;
+inline const size_t MEMBER_NUMBER_SIZE = 32;
+inline const size_t LONG_SIZE_FIELD_SIZE = 64;
+inline const size_t CHECKSUM_SIZE = 32;
+inline const size_t FOOTER_BYTE_SIZE = (LONG_SIZE_FIELD_SIZE + MAGIC_SIZE) / CHAR_BIT;
+
+struct DirectoryEntry {
+    std::string name;
+    uint64_t raw_size = 0;
+    uint64_t offset = 0;
+    uint32_t checksum = 0;
+};
+
+};  // namespace huffman::block
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+// occurrences is a list of (number of occurrences, symbol) with distinct symbols.
+// Returns the canonical order: a list of (code length, symbol) sorted by code length, then by symbol.
+//
+// The tree is never materialised: nodes live in flat arrays and only their parent indices are kept.
+// Leaves and merged nodes go through the same two increasing queues as QueueTwoIncreasing with ties
+// broken by the smallest symbol in a subtree, so the lengths match the ones of existing archives.
+template <typename T>
+std::vector<std::pair<size_t, T>> HuffmanCodeLengths(std::vector<std::pair<size_t, T>> occurrences) {
+    std::sort(occurrences.begin(), occurrences.end());
+
+    const size_t leaves_count = occurrences.size();
+    if (leaves_count <= 1) {
+        std::vector<std::pair<size_t, T>> canonical_order;
+        for (const auto &[number_occurrences, character] : occurrences) {
+            canonical_order.emplace_back(0, character);
+        }
+        return canonical_order;
+    }
+
+    const size_t nodes_count = 2 * leaves_count - 1;
+    std::vector<size_t> weight(nodes_count);
+    std::vector<T> min_character(nodes_count);
+    std::vector<size_t> parent(nodes_count);
+    for (size_t i = 0; i < leaves_count; ++i) {
+        std::tie(weight[i], min_character[i]) = occurrences[i];
+    }
+
+    auto less = [&](size_t left, size_t right) {
+        return std::tie(weight[left], min_character[left]) < std::tie(weight[right], min_character[right]);
+    };
+
+    std::vector<size_t> queue1(leaves_count);
+    std::vector<size_t> queue2;
+    queue2.reserve(leaves_count);
+    for (size_t i = 0; i < leaves_count; ++i) {
+        queue1[i] = i;
+    }
+    size_t head1 = 0;
+    size_t head2 = 0;
+
+    auto extract_min = [&]() {
+        const bool take_first =
+            head2 == queue2.size() || (head1 != queue1.size() && less(queue1[head1], queue2[head2]));
+        return take_first ? queue1[head1++] : queue2[head2++];
+    };
+
+    for (size_t node = leaves_count; node < nodes_count; ++node) {
+        const size_t left = extract_min();
+        const size_t right = extract_min();
+        weight[node] = weight[left] + weight[right];
+        min_character[node] = std::min(min_character[left], min_character[right]);
+        parent[left] = parent[right] = node;
+        if (head1 == queue1.size() || !less(node, queue1.back())) {
+            queue1.push_back(node);
+        } else {
+            queue2.push_back(node);
+        }
+    }
+
+    // Parents always have larger indices than their children, the root is the last node
+    std::vector<size_t> depth(nodes_count);
+    for (size_t node = nodes_count - 1; node-- > 0;) {
+        depth[node] = depth[parent[node]] + 1;
+    }
+
+    std::vector<std::pair<size_t, T>> canonical_order(leaves_count);
+    for (size_t i = 0; i < leaves_count; ++i) {
+        canonical_order[i] = {depth[i], occurrences[i].second};
+    }
+    std::sort(canonical_order.begin(), canonical_order.end());
+    return canonical_order;
+}
+
+// Same as HuffmanCodeLengths, but no code is longer than max_length (which must satisfy
+// 2^max_length >= number of symbols). Uses the package-merge algorithm, so the lengths are optimal
+// among all length-limited prefix codes.
+template <typename T>
+std::vector<std::pair<size_t, T>> LimitedCodeLengths(std::vector<std::pair<size_t, T>> occurrences,
+                                                     size_t max_length) {
+    std::sort(occurrences.begin(), occurrences.end());
+
+    const size_t leaves_count = occurrences.size();
+    if (leaves_count <= 1) {
+        return HuffmanCodeLengths(std::move(occurrences));
+    }
+
+    struct Item {
+        size_t weight;
+        bool is_package;
+        size_t leaf;
+    };
+
+    // lists[d] holds the items available at depth d + 1, lists.back() holds only the leaves
+    std::vector<std::vector<Item>> lists(max_length);
+    for (size_t i = 0; i < leaves_count; ++i) {
+        lists.back().push_back({.weight = occurrences[i].first, .is_package = false, .leaf = i});
+    }
+    for (size_t depth = max_length - 1; depth-- > 0;) {
+        const std::vector<Item> &deeper = lists[depth + 1];
+        std::vector<Item> &current = lists[depth];
+        current.reserve(leaves_count + deeper.size() / 2);
+        size_t leaf = 0;
+        size_t package = 0;
+        while (leaf < leaves_count || package + 1 < deeper.size()) {
+            const bool take_leaf = package + 1 >= deeper.size() ||
+                                   (leaf < leaves_count &&
+                                    occurrences[leaf].first <= deeper[package].weight + deeper[package + 1].weight);
+            if (take_leaf) {
+                current.push_back({.weight = occurrences[leaf].first, .is_package = false, .leaf = leaf});
+                ++leaf;
+            } else {
+                current.push_back(
+                    {.weight = deeper[package].weight + deeper[package + 1].weight, .is_package = true, .leaf = 0});
+                package += 2;
+            }
+        }
+    }
+
+    // Every leaf taken among the first 2n - 2 items of a level is one level deeper in the tree
+    std::vector<size_t> lengths(leaves_count);
+    size_t selected = 2 * leaves_count - 2;
+    for (size_t depth = 0; depth < max_length && selected > 0; ++depth) {
+        size_t packages = 0;
+        for (size_t i = 0; i < std::min(selected, lists[depth].size()); ++i) {
+            if (lists[depth][i].is_package) {
+                ++packages;
+            } else {
+                ++lengths[lists[depth][i].leaf];
+            }
+        }
+        selected = 2 * packages;
+    }
+
+    std::vector<std::pair<size_t, T>> canonical_order(leaves_count);
+    for (size_t i = 0; i < leaves_count; ++i) {
+        canonical_order[i] = {lengths[i], occurrences[i].second};
+    }
+    std::sort(canonical_order.begin(), canonical_order.end());
+    return canonical_order;
+}
+
+// Assigns canonical codes to a canonical order straight from its length histogram.
+template <typename T>
+std::vector<uint64_t> CanonicalCodes(const std::vector<std::pair<size_t, T>> &canonical_order) {
+    std::vector<uint64_t> codes(canonical_order.size());
+    uint64_t code = 0;
+    size_t previous_length = canonical_order.empty() ? 0 : canonical_order.front().first;
+    for (size_t i = 0; i < canonical_order.size(); ++i) {
+        code <<= canonical_order[i].first - previous_length;
+        previous_length = canonical_order[i].first;
+        codes[i] = code++;
+    }
+    return codes;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "lib/reader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Lookup tables for a canonical prefix code: one probe of the primary table resolves codes up to
+// PRIMARY_BITS long, longer codes go through a small secondary table selected by the primary entry.
+// Groups of codes that would need more than MAX_SECONDARY_BITS extra bits are decoded bit by bit.
+template <typename T, size_t PRIMARY_BITS = 11, size_t MAX_SECONDARY_BITS = 10>
+class DecodeTable {
+public:
+    class InvalidCodeException : public std::exception {};
+
+    // canonical_order is a list of (code length, symbol) sorted by code length
+    explicit DecodeTable(const std::vector<std::pair<size_t, T>> &canonical_order) {
+        for (const auto &[code_length, character] : canonical_order) {
+            if (code_length == 0) {
+                throw InvalidCodeException();
+            }
+            if (code_length >= length_count_.size()) {
+                length_count_.resize(code_length + 1);
+            }
+            ++length_count_[code_length];
+            symbols_.push_back(character);
+        }
+        max_length_ = length_count_.empty() ? 0 : length_count_.size() - 1;
+        if (max_length_ >= 64) {
+            throw InvalidCodeException();
+        }
+        primary_bits_ = std::clamp<size_t>(max_length_, 1, PRIMARY_BITS);
+        BuildCanonicalLimits();
+        BuildTables(canonical_order);
+    }
+
+    // Returns nullptr if the input does not start with a valid code
+    const T *Decode(Reader &reader) const {
+        const Entry *entry = &table_[reader.PeekBits<size_t>(primary_bits_)];
+        if (entry->type == EntryType::Secondary) {
+            const size_t bits = reader.PeekBits<size_t>(primary_bits_ + entry->length);
+            entry = &table_[entry->offset + (bits & ((size_t{1} << entry->length) - 1))];
+        } else if (entry->type == EntryType::Long) {
+            return DecodeLong(reader);
+        }
+        if (entry->type != EntryType::Symbol) {
+            return nullptr;
+        }
+        reader.SkipBits(entry->length);
+        return &entry->symbol;
+    }
+
+    size_t GetMaxCodeLength() const {
+        return max_length_;
+    }
+
+private:
+    enum class EntryType : uint8_t { Invalid, Symbol, Secondary, Long };
+
+    struct Entry {
+        T symbol = {};
+        EntryType type = EntryType::Invalid;
+        uint8_t length = 0;   // Code length for symbols, index width for secondary tables
+        uint32_t offset = 0;  // Start of the secondary table
+    };
+
+    std::vector<Entry> table_;
+    std::vector<size_t> length_count_;
+    std::vector<T> symbols_;
+    std::vector<uint64_t> first_code_;    // Canonical code of the first symbol of each length
+    std::vector<size_t> first_symbol_;  // Index in symbols_ of the first symbol of each length
+    size_t max_length_ = 0;
+    size_t primary_bits_ = 1;
+
+    void BuildCanonicalLimits() {
+        first_code_.assign(max_length_ + 1, 0);
+        first_symbol_.assign(max_length_ + 1, 0);
+        uint64_t code = 0;
+        size_t symbol_index = 0;
+        for (size_t length = 1; length <= max_length_; ++length) {
+            code <<= 1;
+            first_code_[length] = code;
+            first_symbol_[length] = symbol_index;
+            code += length_count_[length];
+            symbol_index += length_count_[length];
+            if (code > (uint64_t{1} << length)) {
+                throw InvalidCodeException();  // Over-subscribed code lengths
+            }
+        }
+    }
+
+    void BuildTables(const std::vector<std::pair<size_t, T>> &canonical_order) {
+        std::vector<uint64_t> codes(canonical_order.size());
+        for (size_t length = 1, index = 0; length <= max_length_; ++length) {
+            for (size_t j = 0; j < length_count_[length]; ++j, ++index) {
+                codes[index] = first_code_[length] + j;
+            }
+        }
+        auto prefix = [&](size_t index, size_t prefix_length) {
+            return codes[index] >> (canonical_order[index].first - prefix_length);
+        };
+
+        table_.assign(size_t{1} << primary_bits_, Entry{});
+
+        // Width of the secondary table needed under every primary prefix of a long code
+        for (size_t i = 0; i < canonical_order.size(); ++i) {
+            const size_t length = canonical_order[i].first;
+            if (length <= primary_bits_) {
+                continue;
+            }
+            Entry &entry = table_[prefix(i, primary_bits_)];
+            const size_t extra_bits = length - primary_bits_;
+            if (entry.type == EntryType::Long || extra_bits > MAX_SECONDARY_BITS) {
+                entry.type = EntryType::Long;
+            } else {
+                entry.type = EntryType::Secondary;
+                entry.length = std::max(entry.length, static_cast<uint8_t>(extra_bits));
+            }
+        }
+        const size_t primary_size = table_.size();
+        for (size_t i = 0; i < primary_size; ++i) {
+            if (table_[i].type == EntryType::Secondary) {
+                table_[i].offset = table_.size();
+                table_.resize(table_.size() + (size_t{1} << table_[i].length));
+            }
+        }
+
+        for (size_t i = 0; i < canonical_order.size(); ++i) {
+            const auto [length, character] = canonical_order[i];
+            Entry symbol_entry{.symbol = character, .type = EntryType::Symbol, .length = static_cast<uint8_t>(length)};
+            if (length <= primary_bits_) {
+                const size_t first = prefix(i, length) << (primary_bits_ - length);
+                std::fill_n(table_.begin() + first, size_t{1} << (primary_bits_ - length), symbol_entry);
+                continue;
+            }
+            const Entry primary = table_[prefix(i, primary_bits_)];
+            if (primary.type != EntryType::Secondary) {
+                continue;
+            }
+            const size_t extra_bits = length - primary_bits_;
+            const size_t suffix = codes[i] & ((uint64_t{1} << extra_bits) - 1);
+            const size_t first = primary.offset + (suffix << (primary.length - extra_bits));
+            std::fill_n(table_.begin() + first, size_t{1} << (primary.length - extra_bits), symbol_entry);
+        }
+    }
+
+    const T *DecodeLong(Reader &reader) const {
+        uint64_t code = reader.ReadBits<uint64_t>(primary_bits_);
+        for (size_t length = primary_bits_ + 1; length <= max_length_; ++length) {
+            code = (code << 1) | static_cast<uint64_t>(reader.ReadBit());
+            if (code - first_code_[length] < length_count_[length]) {
+                return &symbols_[first_symbol_[length] + (code - first_code_[length])];
+            }
+        }
+        return nullptr;
+    }
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "lib/reader.h"
+#include "lib/writer.h"
+
+#include <cstdint>
+#include <vector>
+
+// A dictionary is a canonical Huffman table trained on sample files with --train. Archives of many small
+// files code every block with it instead of writing a table per block (see block_format.h). A dictionary
+// file is
+//
+//   dictionary file := MAGIC table
+//
+// where the table is in the legacy layout, padded to a whole byte, and has a code for every byte value.
+namespace huffman::dictionary {
+
+inline const uint32_t MAGIC = 0xFF484144;  // "\xFFHAD"
+inline const size_t MAGIC_SIZE = 32;
+inline const size_t MAX_CODE_LENGTH = 15;  // Bytes that the samples lack still get reasonable codes
+
+// Returns the table of a dictionary file, throws Reader::FileReadError if it is not one
+inline std::vector<char> ReadTable(Reader &reader) {
+    if (reader.ReadBits<uint32_t>(MAGIC_SIZE) != MAGIC) {
+        throw Reader::FileReadError();
+    }
+    std::vector<char> table;
+    std::vector<char> chunk(1 << 12);
+    while (size_t chunk_size = reader.ReadBytes(chunk.data(), chunk.size())) {
+        table.insert(table.end(), chunk.begin(), chunk.begin() + chunk_size);
+    }
+    if (table.empty()) {
+        throw Reader::FileReadError();
+    }
+    return table;
+}
+
+inline void WriteTable(const std::vector<char> &table, Writer &writer) {
+    writer.WriteBits(MAGIC, MAGIC_SIZE);
+    writer.WriteBytes(table.data(), table.size());
+}
+
+};  // namespace huffman::dictionary
@@ -11,5 +11,7 @@ inline const DEFAULT_CHAR_TYPE ONE_MORE_FILE = 257;
 inline const DEFAULT_CHAR_TYPE ARCHIVE_END = 258;
 inline const size_t DEFAULT_IN_CHAR_SIZE = CHAR_BIT;
 inline const size_t DEFAULT_OUT_CHAR_SIZE = 9;
+inline const size_t MIN_CODE_LENGTH_LIMIT = DEFAULT_OUT_CHAR_SIZE;  // Enough for any alphabet of 9-bit symbols
+inline const size_t MAX_CODE_LENGTH_LIMIT = 57;
 
 };  // namespace huffman
\ No newline at end of file
@@ -2,24 +2,158 @@
 
 #include "huffman_constants.h"
 
-#include "lib/trie.h"
 #include "lib/reader.h"
 #include "lib/writer.h"
-#include "decode_trie.h"
+#include "lib/positional_writer.h"
+#include "lib/thread_pool.h"
+#include "lib/crc32c.h"
+#include "lib/lz77.h"
+#include "lib/stats.h"
+#include "decode_table.h"
+#include "block_format.h"
+#include "tans_coder.h"
 
+#include <array>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <optional>
 #include <unordered_map>
+#include <unordered_set>
+
+namespace huffman {
+
+struct DecoderOptions {
+    size_t threads_count = 1;  // Blocks of block archives are decoded in parallel if greater than one
+    std::vector<char> dictionary;  // Table of the dictionary file that archives linked to it need
+    Stats *stats = nullptr;        // Receives the counters and phase times of every decoded file if not null
+    size_t buffer_size = Writer::DEFAULT_FILE_BUFFER_BYTE_SIZE;  // Bytes of buffer for files of legacy archives
+};
+
+};  // namespace huffman
 
 template <typename T = huffman::DEFAULT_CHAR_TYPE, size_t IN_CHAR_SIZE = huffman::DEFAULT_IN_CHAR_SIZE,
           size_t OUT_CHAR_SIZE = huffman::DEFAULT_OUT_CHAR_SIZE>
 class HuffmanDecoder {
-    using CharTrie = Trie<T, 2>;
+    using CharTable = DecodeTable<T>;
+    using DirectoryEntry = huffman::block::DirectoryEntry;
 
 public:
     class FailedDecodeException : public std::exception {};
 
-    bool Decode(Reader &reader) {
+    // The archive is linked to a dictionary, and it is not given or is another one
+    class MissingDictionaryException : public std::exception {};
+
+    class MissingFileException : public std::exception {
+    public:
+        explicit MissingFileException(std::string file_name) : file_name(std::move(file_name)) {
+        }
+
+        std::string file_name;
+    };
+
+    explicit HuffmanDecoder(huffman::DecoderOptions options = {}) : options_(options) {
+    }
+
+    // Writes the contents of all files one after another to output instead of separate files if it is given
+    bool Decode(Reader &reader, Writer *output = nullptr) {
+        Stats::Scope scope(options_.stats);
+        try {
+            if (IsBlockArchive(reader)) {
+                DecodeBlockArchive(reader, output);
+                return true;
+            }
+            while (DecodeFile(reader, output)) {
+            }
+        } catch (const FailedDecodeException &e) {
+            return false;
+        } catch (const PositionalWriter::FileWriteError &e) {
+            return false;  // The member files that were being written are already emptied
+        }
+        return true;
+    }
+
+    // Decodes only the files with the given names, the last one wins if a name occurs several times.
+    // Seekable block archives are read through the directory, so the other members are never read.
+    // Throws MissingFileException if a name is not in the archive
+    bool Extract(Reader &reader, const std::vector<std::string> &file_names) {
+        Stats::Scope scope(options_.stats);
+        const std::unordered_set<std::string> selected(file_names.begin(), file_names.end());
+        std::vector<DirectoryEntry> decoded;
+        try {
+            if (IsBlockArchive(reader) && reader.IsSeekable()) {
+                const ArchiveHeader header = ReadArchiveHeader(reader);
+                const std::vector<DirectoryEntry> directory = ReadDirectory(reader, header.version);
+                std::unordered_map<std::string, const DirectoryEntry *> last_entry;
+                for (const auto &entry : directory) {
+                    if (selected.contains(entry.name)) {
+                        last_entry[entry.name] = &entry;
+                    }
+                }
+                ThrowIfMissing(file_names, [&](const std::string &name) { return last_entry.contains(name); });
+
+                std::vector<const DirectoryEntry *> entries;
+                for (const auto &entry : directory) {
+                    if (last_entry[entry.name] == &entry) {
+                        entries.push_back(&entry);
+                    }
+                }
+                ExtractBlockMembers(reader, header, directory, entries);
+                return true;
+            }
+            if (IsBlockArchive(reader)) {
+                DecodeBlockArchive(reader, nullptr, &selected, &decoded);
+            } else {
+                while (DecodeFile(reader, nullptr, &selected, &decoded)) {
+                }
+            }
+            std::unordered_set<std::string> decoded_names;
+            for (const auto &entry : decoded) {
+                decoded_names.insert(entry.name);
+            }
+            ThrowIfMissing(file_names, [&](const std::string &name) { return decoded_names.contains(name); });
+        } catch (const FailedDecodeException &e) {
+            return false;
+        } catch (const PositionalWriter::FileWriteError &e) {
+            return false;
+        }
+        return true;
+    }
+
+    // Decodes the whole archive without writing anything, checking the block and member checksums of
+    // block archives that have them. Legacy archives can only fail to decode. An archive that ends too
+    // early fails like a damaged one
+    bool Verify(Reader &reader) {
+        Stats::Scope scope(options_.stats);
+        try {
+            if (IsBlockArchive(reader)) {
+                VerifyBlockArchive(reader);
+                return true;
+            }
+            const std::unordered_set<std::string> nothing;
+            while (DecodeFile(reader, nullptr, &nothing)) {
+            }
+        } catch (const FailedDecodeException &e) {
+            return false;
+        } catch (const Reader::FileReadError &e) {
+            return false;  // A truncated archive is damaged as well
+        }
+        return true;
+    }
+
+    // Lists archived files without writing anything. Legacy archives have to be decoded for that,
+    // their entries have only names and sizes
+    bool List(Reader &reader, std::vector<DirectoryEntry> &entries) {
+        entries.clear();
         try {
-            while (DecodeFile(reader)) {
+            if (IsBlockArchive(reader)) {
+                const ArchiveHeader header = ReadArchiveHeader(reader, false);
+                entries = ReadDirectory(reader, header.version);
+                return true;
+            }
+            const std::unordered_set<std::string> nothing;
+            while (DecodeFile(reader, nullptr, &nothing, &entries)) {
             }
         } catch (const FailedDecodeException &e) {
             return false;
@@ -28,7 +162,76 @@ public:
     }
 
 private:
-    CharTrie ReadHuffmanData(Reader &reader) {
+    struct ArchiveHeader {
+        uint8_t version = 0;
+        std::shared_ptr<const CharTable> dictionary = nullptr;  // Only if the archive has one and it is read
+    };
+
+    // Blocks of a member go either into place in its file or, in order, to the stream of the pipeline
+    struct MemberOutput {
+        MemberOutput() = default;
+
+        explicit MemberOutput(const std::string &file_name) {
+            file.emplace(file_name);
+        }
+
+        std::optional<PositionalWriter> file;
+        uint32_t checksum = 0;         // CRC-32C of the blocks finished so far
+        Stats::Record *stats = nullptr;  // Only if stats are collected
+    };
+
+    struct DecodedBlock {
+        uint32_t checksum = 0;    // Only if checksums are computed
+        std::vector<char> data;  // Only if the member goes to the stream
+    };
+
+    struct PendingBlock {
+        std::future<DecodedBlock> result;
+        std::shared_ptr<MemberOutput> output;
+        size_t raw_size = 0;
+    };
+
+    // Blocks are decoded on the pool and written into place, the sizes in block headers give their offsets.
+    // Blocks of members without a file go to the stream, or nowhere if there is no stream
+    struct BlockPipeline {
+        BlockPipeline(size_t threads_count, const ArchiveHeader &header, bool with_checksums,
+                      Writer *stream = nullptr)
+            : pool(threads_count > 1 ? threads_count : 0),
+              max_pending(2 * std::max<size_t>(threads_count, 1)),
+              with_checksums(with_checksums),
+              has_block_checksums(header.version >= huffman::block::FIRST_BLOCK_CHECKSUM_VERSION),
+              dictionary(header.dictionary),
+              stream(stream) {
+        }
+
+        ThreadPool pool;
+        const size_t max_pending;
+        const bool with_checksums;       // Member checksums are computed
+        const bool has_block_checksums;  // Every block is checked against the checksum in its header
+        const std::shared_ptr<const CharTable> dictionary;
+        Writer *const stream;
+        std::deque<PendingBlock> pending;
+        std::shared_ptr<MemberOutput> output;  // Member whose blocks are being read
+    };
+
+    huffman::DecoderOptions options_;
+
+    Stats::Record *AddStatsFile(const std::string &file_name) {
+        return options_.stats != nullptr ? &options_.stats->AddFile(file_name) : nullptr;
+    }
+
+    template <typename Contains>
+    static void ThrowIfMissing(const std::vector<std::string> &file_names, Contains contains) {
+        for (const auto &file_name : file_names) {
+            if (!contains(file_name)) {
+                throw MissingFileException(file_name);
+            }
+        }
+    }
+
+    CharTable ReadHuffmanData(Reader &reader) {
+        Stats::PhaseTimer timer(Stats::Phase::TableBuild);
+        Stats::Add(Stats::Counter::Tables, 1);
         const size_t symbols_count = reader.ReadBits<T>(OUT_CHAR_SIZE);
 
         std::vector<std::pair<size_t, T>> canonical_order(symbols_count);
@@ -40,19 +243,26 @@ private:
         size_t code_size = 1;
         while (current_char_index < symbols_count) {
             size_t number_symbol_with_code_size = reader.ReadBits<T>(OUT_CHAR_SIZE);
+            if (number_symbol_with_code_size > symbols_count - current_char_index) {
+                throw FailedDecodeException();
+            }
             for (size_t j = 0; j < number_symbol_with_code_size; ++j) {
                 canonical_order[current_char_index].first = code_size;
                 ++current_char_index;
             }
             ++code_size;
         }
-        return DecodeTrie(canonical_order);
+        try {
+            return CharTable(canonical_order);
+        } catch (const typename CharTable::InvalidCodeException &e) {
+            throw FailedDecodeException();
+        }
     }
 
-    std::string DecodeFileName(Reader &reader, CharTrie &trie) {
+    std::string DecodeFileName(Reader &reader, const CharTable &table) {
         std::string file_name;
         while (true) {
-            auto current_char_ptr = trie.TraverseOnce([&reader]() { return reader.ReadBit(); });
+            auto current_char_ptr = table.Decode(reader);
             if (current_char_ptr == nullptr) {
                 throw FailedDecodeException();
             }
@@ -64,23 +274,602 @@ private:
         return file_name;
     }
 
-    bool DecodeFile(Reader &reader) {
-        CharTrie trie = ReadHuffmanData(reader);
+    // Decodes the next file of a legacy archive, returns false after the last one. The file goes to output
+    // if it is given, only the selected files are written if selected is given. decoded receives the names
+    // and sizes of all files
+    bool DecodeFile(Reader &reader, Writer *output = nullptr, const std::unordered_set<std::string> *selected = nullptr,
+                    std::vector<DirectoryEntry> *decoded = nullptr) {
+        CharTable table = ReadHuffmanData(reader);
 
-        std::string file_name = DecodeFileName(reader, trie);
-        Writer writer(file_name);
+        std::string file_name = DecodeFileName(reader, table);
+        std::optional<Writer> file_writer;
+        Writer *writer = nullptr;
+        if (selected == nullptr || selected->contains(file_name)) {
+            writer = output != nullptr ? output : &file_writer.emplace(file_name, options_.buffer_size);
+        }
+        Stats::Scope file_scope(options_.stats, writer != nullptr ? AddStatsFile(file_name) : nullptr);
+        Stats::PhaseTimer timer(Stats::Phase::Coding);
 
+        uint64_t file_size = 0;
         while (true) {
-            auto current_char_ptr = trie.TraverseOnce([&reader]() { return reader.ReadBit(); });
+            auto current_char_ptr = table.Decode(reader);
             if (current_char_ptr == nullptr) {
-                writer.Clear();
+                if (writer != nullptr) {
+                    writer->Clear();
+                }
                 throw FailedDecodeException();
             }
             if (*current_char_ptr == huffman::ARCHIVE_END || *current_char_ptr == huffman::ONE_MORE_FILE) {
+                Stats::Add(Stats::Counter::RawBytes, file_size);
+                Stats::Add(Stats::Counter::Symbols, file_name.size() + 1 + file_size + 1);
+                if (decoded != nullptr) {
+                    decoded->push_back({.name = std::move(file_name), .raw_size = file_size});
+                }
                 return *current_char_ptr == huffman::ONE_MORE_FILE;
             }
-            writer.WriteBits(*current_char_ptr, IN_CHAR_SIZE);
+            if (writer != nullptr) {
+                writer->WriteBits(*current_char_ptr, IN_CHAR_SIZE);
+            }
+            ++file_size;
         }
         return false;
     }
-};
\ No newline at end of file
+
+    static bool IsBlockArchive(Reader &reader) {
+        return reader.PeekBits<uint32_t>(huffman::block::MAGIC_SIZE) == huffman::block::MAGIC;
+    }
+
+    // The dictionary is skipped unless it is needed for decoding. Throws MissingDictionaryException if
+    // it is needed and the archive is linked to a dictionary other than the one in the options
+    ArchiveHeader ReadArchiveHeader(Reader &reader, bool with_dictionary = true) {
+        reader.SkipBits(huffman::block::MAGIC_SIZE);
+        ArchiveHeader header{.version = reader.ReadBits<uint8_t>(huffman::block::VERSION_SIZE)};
+        if (header.version == 0 || header.version > huffman::block::VERSION) {
+            throw FailedDecodeException();
+        }
+        reader.ReadBits<size_t>(huffman::block::SIZE_FIELD_SIZE);  // Block size is only a hint for decoding
+        if (header.version < huffman::block::FIRST_DICTIONARY_VERSION) {
+            return header;
+        }
+
+        const uint8_t kind = reader.ReadBits<uint8_t>(huffman::block::DICTIONARY_KIND_SIZE);
+        std::vector<char> table;
+        if (kind == huffman::block::EMBEDDED_DICTIONARY) {
+            table.resize(reader.ReadBits<size_t>(huffman::block::SIZE_FIELD_SIZE));
+            if (reader.ReadBytes(table.data(), table.size()) != table.size()) {
+                throw Reader::FileReadError();
+            }
+        } else if (kind == huffman::block::LINKED_DICTIONARY) {
+            const uint32_t checksum = reader.ReadBits<uint32_t>(huffman::block::CHECKSUM_SIZE);
+            if (with_dictionary && (options_.dictionary.empty() ||
+                                    Crc32c(options_.dictionary.data(), options_.dictionary.size()) != checksum)) {
+                throw MissingDictionaryException();
+            }
+            table = options_.dictionary;
+        } else if (kind != huffman::block::NO_DICTIONARY) {
+            throw FailedDecodeException();
+        }
+        if (with_dictionary && !table.empty()) {
+            Reader table_reader(std::move(table));
+            header.dictionary = std::make_shared<const CharTable>(ReadHuffmanData(table_reader));
+        }
+        return header;
+    }
+
+    // Returns ARCHIVE_END at the end of the archive
+    uint8_t ReadMemberTag(Reader &reader) {
+        const uint8_t tag = reader.ReadBits<uint8_t>(huffman::block::TAG_SIZE);
+        if (tag != huffman::block::MEMBER && tag != huffman::block::MEMBER_COPY && tag != huffman::block::ARCHIVE_END) {
+            throw FailedDecodeException();
+        }
+        return tag;
+    }
+
+    // Number of the member that a copy repeats, which must be one of the members_count before it
+    size_t ReadSourceNumber(Reader &reader, size_t members_count) {
+        const size_t source = reader.ReadBits<size_t>(huffman::block::MEMBER_NUMBER_SIZE);
+        if (source >= members_count) {
+            throw FailedDecodeException();
+        }
+        return source;
+    }
+
+    std::string ReadName(Reader &reader) {
+        std::string name(reader.ReadBits<size_t>(huffman::block::NAME_LENGTH_SIZE), 0);
+        if (reader.ReadBytes(name.data(), name.size()) != name.size()) {
+            throw Reader::FileReadError();
+        }
+        return name;
+    }
+
+    // Reader must be right after the archive header. Archives without a directory and inputs that can't
+    // seek to it are walked member by member, skipping the payloads; their entries have no checksums
+    std::vector<DirectoryEntry> ReadDirectory(Reader &reader, uint8_t version) {
+        std::vector<DirectoryEntry> directory;
+        if (version < huffman::block::FIRST_DIRECTORY_VERSION || !reader.IsSeekable()) {
+            while (const uint8_t tag = ReadMemberTag(reader)) {
+                DirectoryEntry &entry = directory.emplace_back();
+                entry.offset = reader.Tell() - huffman::block::TAG_SIZE / CHAR_BIT;
+                entry.name = ReadName(reader);
+                if (tag == huffman::block::MEMBER_COPY) {
+                    entry.raw_size = directory[ReadSourceNumber(reader, directory.size() - 1)].raw_size;
+                    continue;
+                }
+                while (reader.ReadBits<uint8_t>(huffman::block::CODEC_SIZE) != huffman::block::MEMBER_END) {
+                    entry.raw_size += reader.ReadBits<size_t>(huffman::block::SIZE_FIELD_SIZE);
+                    const size_t payload_size = reader.ReadBits<size_t>(huffman::block::SIZE_FIELD_SIZE);
+                    if (version >= huffman::block::FIRST_BLOCK_CHECKSUM_VERSION) {
+                        reader.ReadBits<uint32_t>(huffman::block::CHECKSUM_SIZE);
+                    }
+                    reader.Seek(reader.Tell() + payload_size);
+                }
+            }
+            return directory;
+        }
+
+        const size_t archive_size = reader.GetSize();
+        if (archive_size < huffman::block::FOOTER_BYTE_SIZE) {
+            throw FailedDecodeException();
+        }
+        reader.Seek(archive_size - huffman::block::FOOTER_BYTE_SIZE);
+        const uint64_t directory_offset = reader.ReadBits<uint64_t>(huffman::block::LONG_SIZE_FIELD_SIZE);
+        if (reader.ReadBits<uint32_t>(huffman::block::MAGIC_SIZE) != huffman::block::MAGIC ||
+            directory_offset > archive_size - huffman::block::FOOTER_BYTE_SIZE) {
+            throw FailedDecodeException();
+        }
+        reader.Seek(directory_offset);
+        const size_t members_count = reader.ReadBits<size_t>(huffman::block::COUNT_SIZE);
+        if (members_count > archive_size - directory_offset) {
+            throw FailedDecodeException();  // Every entry takes more than a byte
+        }
+        directory.resize(members_count);
+        for (auto &entry : directory) {
+            entry.name = ReadName(reader);
+            entry.raw_size = reader.ReadBits<uint64_t>(huffman::block::LONG_SIZE_FIELD_SIZE);
+            entry.offset = reader.ReadBits<uint64_t>(huffman::block::LONG_SIZE_FIELD_SIZE);
+            entry.checksum = reader.ReadBits<uint32_t>(huffman::block::CHECKSUM_SIZE);
+        }
+        return directory;
+    }
+
+    // Same parameters as in DecodeFile, the members that are not selected are skipped without decoding.
+    // A copy of a member that is already in its file is copied from there, other copies decode their
+    // source again, which needs a seekable input
+    void DecodeBlockArchive(Reader &reader, Writer *output = nullptr,
+                            const std::unordered_set<std::string> *selected = nullptr,
+                            std::vector<DirectoryEntry> *decoded = nullptr) {
+        const ArchiveHeader header = ReadArchiveHeader(reader);
+        BlockPipeline pipeline(options_.threads_count, header, false, output);
+        std::vector<DirectoryEntry> members;
+        std::unordered_map<std::string, size_t> last_written;  // Member last written to every file
+        try {
+            while (const uint8_t tag = ReadMemberTag(reader)) {
+                DirectoryEntry &member = members.emplace_back();
+                member.offset = reader.Tell() - huffman::block::TAG_SIZE / CHAR_BIT;
+                member.name = ReadName(reader);
+                std::optional<size_t> source;
+                if (tag == huffman::block::MEMBER_COPY) {
+                    source = ReadSourceNumber(reader, members.size() - 1);
+                    member.raw_size = members[*source].raw_size;
+                }
+                if (selected != nullptr && !selected->contains(member.name)) {
+                    if (!source) {
+                        member.raw_size = DecodeMemberBlocks(reader, pipeline, nullptr);
+                    }
+                    continue;
+                }
+
+                std::shared_ptr<MemberOutput> member_output;
+                if (output != nullptr) {
+                    member_output = std::make_shared<MemberOutput>();
+                    member_output->stats = AddStatsFile(member.name);
+                } else {
+                    if (last_written.contains(member.name) || source) {
+                        FinishBlocks(pipeline, 0);  // The earlier blocks of the file must not race with it
+                    }
+                    auto source_file = source ? last_written.find(members[*source].name) : last_written.end();
+                    const bool is_source_written = source_file != last_written.end() && source_file->second == *source;
+                    last_written[member.name] = members.size() - 1;
+                    if (is_source_written) {
+                        if (members[*source].name == member.name) {
+                            continue;  // The file already has the data
+                        }
+                        std::filesystem::copy_file(members[*source].name, member.name,
+                                                   std::filesystem::copy_options::overwrite_existing);
+                        continue;
+                    }
+                    member_output = std::make_shared<MemberOutput>(member.name);
+                    member_output->stats = AddStatsFile(member.name);
+                }
+                if (!source) {
+                    member.raw_size = DecodeMemberBlocks(reader, pipeline, member_output);
+                } else if (DecodeSourceAgain(reader, pipeline, members[*source], member_output) != member.raw_size) {
+                    throw FailedDecodeException();
+                }
+            }
+            FinishBlocks(pipeline, 0);
+        } catch (...) {
+            AbortBlocks(pipeline);
+            throw;
+        }
+        if (decoded != nullptr) {
+            for (auto &member : members) {
+                decoded->push_back({.name = std::move(member.name), .raw_size = member.raw_size});
+            }
+        }
+    }
+
+    // The directory right after ARCHIVE_END must describe the decoded members
+    void VerifyBlockArchive(Reader &reader) {
+        const ArchiveHeader header = ReadArchiveHeader(reader);
+        BlockPipeline pipeline(options_.threads_count, header, true);
+        std::vector<DirectoryEntry> members;
+        std::vector<std::shared_ptr<MemberOutput>> outputs;  // Checksums of the members, shared by copies
+        try {
+            while (const uint8_t tag = ReadMemberTag(reader)) {
+                DirectoryEntry &member = members.emplace_back();
+                member.offset = reader.Tell() - huffman::block::TAG_SIZE / CHAR_BIT;
+                member.name = ReadName(reader);
+                if (tag == huffman::block::MEMBER_COPY) {
+                    const size_t source = ReadSourceNumber(reader, members.size() - 1);
+                    member.raw_size = members[source].raw_size;
+                    outputs.push_back(outputs[source]);
+                    continue;
+                }
+                outputs.push_back(std::make_shared<MemberOutput>());
+                outputs.back()->stats = AddStatsFile(member.name);
+                member.raw_size = DecodeMemberBlocks(reader, pipeline, outputs.back());
+            }
+            FinishBlocks(pipeline, 0);
+        } catch (...) {
+            AbortBlocks(pipeline);
+            throw;
+        }
+        if (header.version < huffman::block::FIRST_DIRECTORY_VERSION) {
+            return;
+        }
+
+        const uint64_t directory_offset = reader.Tell();
+        if (reader.ReadBits<size_t>(huffman::block::COUNT_SIZE) != members.size()) {
+            throw FailedDecodeException();
+        }
+        for (size_t i = 0; i < members.size(); ++i) {
+            if (ReadName(reader) != members[i].name ||
+                reader.ReadBits<uint64_t>(huffman::block::LONG_SIZE_FIELD_SIZE) != members[i].raw_size ||
+                reader.ReadBits<uint64_t>(huffman::block::LONG_SIZE_FIELD_SIZE) != members[i].offset ||
+                reader.ReadBits<uint32_t>(huffman::block::CHECKSUM_SIZE) != outputs[i]->checksum) {
+                throw FailedDecodeException();
+            }
+        }
+        if (reader.ReadBits<uint64_t>(huffman::block::LONG_SIZE_FIELD_SIZE) != directory_offset ||
+            reader.ReadBits<uint32_t>(huffman::block::MAGIC_SIZE) != huffman::block::MAGIC || !reader.IsEof()) {
+            throw FailedDecodeException();
+        }
+    }
+
+    // Decodes the blocks of an earlier member into output and comes back. Returns the member size
+    uint64_t DecodeSourceAgain(Reader &reader, BlockPipeline &pipeline, const DirectoryEntry &source,
+                               const std::shared_ptr<MemberOutput> &output) {
+        if (!reader.IsSeekable()) {
+            throw FailedDecodeException();
+        }
+        const size_t position = reader.Tell();
+        reader.Seek(source.offset);
+        if (ReadMemberTag(reader) != huffman::block::MEMBER || ReadName(reader) != source.name) {
+            throw FailedDecodeException();
+        }
+        const uint64_t raw_size = DecodeMemberBlocks(reader, pipeline, output);
+        reader.Seek(position);
+        return raw_size;
+    }
+
+    // Copies of extracted members are copied from their files, other copies decode their source again
+    void ExtractBlockMembers(Reader &reader, const ArchiveHeader &header, const std::vector<DirectoryEntry> &directory,
+                             const std::vector<const DirectoryEntry *> &entries) {
+        const bool has_checksums = header.version >= huffman::block::FIRST_DIRECTORY_VERSION;
+        BlockPipeline pipeline(options_.threads_count, header, has_checksums);
+        std::vector<std::pair<std::shared_ptr<MemberOutput>, uint64_t>> outputs;  // Outputs with their sizes
+        std::vector<std::pair<const DirectoryEntry *, const DirectoryEntry *>> copies;  // Sources with copies
+        const std::unordered_set<const DirectoryEntry *> extracted(entries.begin(), entries.end());
+        try {
+            for (const DirectoryEntry *entry : entries) {
+                reader.Seek(entry->offset);
+                const uint8_t tag = ReadMemberTag(reader);
+                if (tag == huffman::block::ARCHIVE_END || ReadName(reader) != entry->name) {
+                    throw FailedDecodeException();
+                }
+                if (tag == huffman::block::MEMBER_COPY) {
+                    const DirectoryEntry *source =
+                        &directory[ReadSourceNumber(reader, static_cast<size_t>(entry - directory.data()))];
+                    if (extracted.contains(source)) {
+                        copies.emplace_back(source, entry);
+                        outputs.emplace_back(nullptr, 0);
+                        continue;
+                    }
+                    reader.Seek(source->offset);
+                    if (ReadMemberTag(reader) != huffman::block::MEMBER || ReadName(reader) != source->name) {
+                        throw FailedDecodeException();
+                    }
+                }
+                auto output = std::make_shared<MemberOutput>(entry->name);
+                output->stats = AddStatsFile(entry->name);
+                outputs.emplace_back(output, DecodeMemberBlocks(reader, pipeline, output));
+            }
+            FinishBlocks(pipeline, 0);
+        } catch (...) {
+            AbortBlocks(pipeline);
+            throw;
+        }
+
+        bool is_intact = true;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const auto &[output, raw_size] = outputs[i];
+            if (output &&
+                (raw_size != entries[i]->raw_size || (has_checksums && output->checksum != entries[i]->checksum))) {
+                output->file->Clear();
+                is_intact = false;
+            }
+        }
+        if (!is_intact) {
+            throw FailedDecodeException();
+        }
+        for (const auto &[source, copy] : copies) {
+            if (source->raw_size != copy->raw_size || source->checksum != copy->checksum) {
+                throw FailedDecodeException();
+            }
+            if (source->name != copy->name) {
+                std::filesystem::copy_file(source->name, copy->name, std::filesystem::copy_options::overwrite_existing);
+            }
+        }
+    }
+
+    // Reads the blocks of a member up to MEMBER_END and hands them to the pool, they are skipped if there
+    // is no output. Returns the member size
+    uint64_t DecodeMemberBlocks(Reader &reader, BlockPipeline &pipeline, const std::shared_ptr<MemberOutput> &output) {
+        Stats::Scope scope(options_.stats, output ? output->stats : nullptr);
+        pipeline.output = output;
+        uint64_t raw_offset = 0;
+        while (true) {
+            const size_t block_start_bits = reader.Tell() * CHAR_BIT;
+            const uint8_t codec = reader.ReadBits<uint8_t>(huffman::block::CODEC_SIZE);
+            if (codec == huffman::block::MEMBER_END) {
+                break;
+            }
+            const size_t raw_size = reader.ReadBits<size_t>(huffman::block::SIZE_FIELD_SIZE);
+            const size_t payload_size = reader.ReadBits<size_t>(huffman::block::SIZE_FIELD_SIZE);
+            const uint32_t checksum =
+                pipeline.has_block_checksums ? reader.ReadBits<uint32_t>(huffman::block::CHECKSUM_SIZE) : 0;
+            raw_offset += raw_size;
+            if (!output) {
+                reader.Seek(reader.Tell() + payload_size);
+                continue;
+            }
+            std::vector<char> payload(payload_size);
+            if (reader.ReadBytes(payload.data(), payload.size()) != payload.size()) {
+                throw Reader::FileReadError();
+            }
+            Stats::Add(Stats::Counter::ArchiveBits, reader.Tell() * CHAR_BIT - block_start_bits);
+            auto result = pipeline.pool.Submit([this, output, codec, payload = std::move(payload), raw_size, checksum,
+                                                offset = raw_offset - raw_size,
+                                                with_checksums = pipeline.with_checksums,
+                                                has_block_checksums = pipeline.has_block_checksums,
+                                                to_stream = pipeline.stream != nullptr,
+                                                dictionary = pipeline.dictionary]() mutable {
+                Stats::Scope scope(options_.stats, output->stats);
+                DecodedBlock block{.data = DecodeBlock(codec, std::move(payload), raw_size, dictionary.get())};
+                if (with_checksums || has_block_checksums) {
+                    block.checksum = Crc32c(block.data.data(), block.data.size());
+                    if (has_block_checksums && block.checksum != checksum) {
+                        throw FailedDecodeException();
+                    }
+                }
+                if (output->file) {
+                    output->file->Write(block.data.data(), block.data.size(), offset);
+                }
+                if (output->file || !to_stream) {
+                    block.data = {};
+                }
+                return block;
+            });
+            pipeline.pending.push_back({.result = std::move(result), .output = output, .raw_size = raw_size});
+            FinishBlocks(pipeline, pipeline.max_pending);
+        }
+        pipeline.output.reset();
+        return raw_offset;
+    }
+
+    // Waits for the oldest blocks until at most max_pending are left. Blocks are popped only once they
+    // succeed and in order, so the checksum of every member is extended block by block
+    void FinishBlocks(BlockPipeline &pipeline, size_t max_pending) {
+        while (pipeline.pending.size() > max_pending) {
+            PendingBlock &block = pipeline.pending.front();
+            const DecodedBlock decoded = block.result.get();
+            if (pipeline.with_checksums) {
+                block.output->checksum = Crc32cCombine(block.output->checksum, decoded.checksum, block.raw_size);
+            }
+            if (!block.output->file && pipeline.stream != nullptr) {
+                pipeline.stream->WriteBytes(decoded.data.data(), decoded.data.size());
+            }
+            pipeline.pending.pop_front();
+        }
+    }
+
+    // Leaves empty every output with a failed block and the member that was being read
+    void AbortBlocks(BlockPipeline &pipeline) {
+        // Every block has to finish before an output is emptied. A consumed future is the one that failed
+        for (auto &block : pipeline.pending) {
+            if (block.result.valid()) {
+                block.result.wait();
+            }
+        }
+        auto clear = [](MemberOutput &output) {
+            if (output.file) {
+                output.file->Clear();
+            }
+        };
+        for (auto &block : pipeline.pending) {
+            if (!block.result.valid()) {
+                clear(*block.output);
+                continue;
+            }
+            try {
+                block.result.get();
+            } catch (...) {
+                clear(*block.output);
+            }
+        }
+        if (pipeline.output) {
+            clear(*pipeline.output);
+        }
+    }
+
+    // dictionary codes the blocks of its codec, there are none without it
+    std::vector<char> DecodeBlock(uint8_t codec, std::vector<char> payload, size_t raw_size,
+                                  const CharTable *dictionary) {
+        if (raw_size > huffman::block::MAX_BLOCK_SIZE) {
+            throw FailedDecodeException();
+        }
+        Stats::Add(Stats::Counter::Blocks, 1);
+        Stats::Add(Stats::Counter::RawBytes, raw_size);
+        if (codec != huffman::block::CODEC_STORED && codec != huffman::block::CODEC_LZ_HUFFMAN) {
+            Stats::Add(Stats::Counter::Symbols, raw_size);
+        }
+        if (codec == huffman::block::CODEC_STORED) {
+            if (payload.size() != raw_size) {
+                throw FailedDecodeException();
+            }
+            return payload;
+        }
+        Reader reader(std::move(payload));
+        std::vector<char> block(raw_size);
+        if (codec == huffman::block::CODEC_TANS) {
+            try {
+                const TansDecoder decoder = [&] {
+                    Stats::PhaseTimer timer(Stats::Phase::TableBuild);
+                    Stats::Add(Stats::Counter::Tables, 1);
+                    return TansDecoder(reader);
+                }();
+                Stats::PhaseTimer timer(Stats::Phase::Coding);
+                decoder.Decode(reader, block.data(), block.size());
+            } catch (const TansDecoder::InvalidTableException &e) {
+                throw FailedDecodeException();
+            }
+            return block;
+        }
+        if (codec == huffman::block::CODEC_DICTIONARY_HUFFMAN) {
+            if (dictionary == nullptr) {
+                throw FailedDecodeException();
+            }
+            Stats::PhaseTimer timer(Stats::Phase::Coding);
+            for (auto &value : block) {
+                value = DecodeByte(reader, *dictionary);
+            }
+            return block;
+        }
+        CharTable table = ReadHuffmanData(reader);
+        Stats::PhaseTimer timer(Stats::Phase::Coding);
+        if (codec == huffman::block::CODEC_LZ_HUFFMAN) {
+            DecodeLzBlock(reader, table, block);
+        } else if (codec == huffman::block::CODEC_HUFFMAN) {
+            for (auto &value : block) {
+                value = DecodeByte(reader, table);
+            }
+        } else if (codec == huffman::block::CODEC_HUFFMAN_4_STREAMS) {
+            DecodeStreams(reader, table, block);
+        } else {
+            throw FailedDecodeException();
+        }
+        return block;
+    }
+
+    // The streams are independent, so decoding one symbol from each per iteration keeps four bit
+    // dependency chains in flight
+    void DecodeStreams(Reader &reader, const CharTable &table, std::vector<char> &block) {
+        static_assert(huffman::block::STREAMS_COUNT == 4);
+        reader.AlignToByte();
+        std::array<std::vector<char>, huffman::block::STREAMS_COUNT> stream_data;
+        size_t sizes_sum = 0;
+        for (size_t i = 0; i + 1 < stream_data.size(); ++i) {
+            stream_data[i].resize(reader.ReadBits<size_t>(huffman::block::SIZE_FIELD_SIZE));
+            sizes_sum += stream_data[i].size();
+        }
+        if (sizes_sum > reader.GetSize() - reader.Tell()) {
+            throw FailedDecodeException();
+        }
+        stream_data.back().resize(reader.GetSize() - reader.Tell() - sizes_sum);
+        for (auto &data : stream_data) {
+            reader.ReadBytes(data.data(), data.size());
+        }
+        std::array<Reader, huffman::block::STREAMS_COUNT> streams = {
+            Reader(std::move(stream_data[0])), Reader(std::move(stream_data[1])), Reader(std::move(stream_data[2])),
+            Reader(std::move(stream_data[3]))};
+
+        // Parts are consecutive and never longer than the first one, the last one is the shortest
+        const size_t part_size = (block.size() + streams.size() - 1) / streams.size();
+        std::array<char *, huffman::block::STREAMS_COUNT> parts;
+        std::array<size_t, huffman::block::STREAMS_COUNT> part_sizes;
+        for (size_t i = 0; i < streams.size(); ++i) {
+            const size_t begin = std::min(i * part_size, block.size());
+            parts[i] = block.data() + begin;
+            part_sizes[i] = std::min(part_size, block.size() - begin);
+        }
+        const size_t common_size = part_sizes.back();
+        for (size_t j = 0; j < common_size; ++j) {
+            parts[0][j] = DecodeByte(streams[0], table);
+            parts[1][j] = DecodeByte(streams[1], table);
+            parts[2][j] = DecodeByte(streams[2], table);
+            parts[3][j] = DecodeByte(streams[3], table);
+        }
+        for (size_t i = 0; i < streams.size(); ++i) {
+            for (size_t j = common_size; j < part_sizes[i]; ++j) {
+                parts[i][j] = DecodeByte(streams[i], table);
+            }
+        }
+    }
+
+    void DecodeLzBlock(Reader &reader, const CharTable &symbol_table, std::vector<char> &block) {
+        const CharTable distance_table = ReadHuffmanData(reader);
+        size_t position = 0;
+        size_t symbols_count = 0;
+        for (; position < block.size(); ++symbols_count) {
+            auto symbol_ptr = symbol_table.Decode(reader);
+            if (symbol_ptr == nullptr || *symbol_ptr >= (1 << IN_CHAR_SIZE) + lz77::LENGTH_CODES_COUNT) {
+                throw FailedDecodeException();
+            }
+            if (*symbol_ptr < (1 << IN_CHAR_SIZE)) {
+                block[position++] = static_cast<char>(*symbol_ptr);
+                continue;
+            }
+            const uint32_t length_code = *symbol_ptr - (1 << IN_CHAR_SIZE);
+            const size_t length = lz77::MIN_MATCH + lz77::JoinValue(length_code, reader.ReadBits<uint32_t>(
+                                                                                    lz77::ExtraBitsCount(length_code)));
+            auto distance_ptr = distance_table.Decode(reader);
+            if (distance_ptr == nullptr || *distance_ptr >= lz77::DISTANCE_CODES_COUNT) {
+                throw FailedDecodeException();
+            }
+            const size_t distance =
+                1 + lz77::JoinValue(*distance_ptr, reader.ReadBits<uint32_t>(lz77::ExtraBitsCount(*distance_ptr)));
+            if (distance > position || length > block.size() - position) {
+                throw FailedDecodeException();
+            }
+            char *output = block.data() + position;
+            if (distance >= length) {
+                std::memcpy(output, output - distance, length);
+            } else {
+                for (size_t i = 0; i < length; ++i) {
+                    output[i] = output[i - distance];  // Overlapping matches repeat the last distance bytes
+                }
+            }
+            position += length;
+        }
+        Stats::Add(Stats::Counter::Symbols, symbols_count);
+    }
+
+    char DecodeByte(Reader &reader, const CharTable &table) {
+        auto current_char_ptr = table.Decode(reader);
+        if (current_char_ptr == nullptr || *current_char_ptr >= (1 << IN_CHAR_SIZE)) {
+            throw FailedDecodeException();
+        }
+        return static_cast<char>(*current_char_ptr);
+    }
+};
@@ -2,145 +2,809 @@
 
 #include "huffman_constants.h"
 
-#include "lib/trie.h"
 #include "lib/reader.h"
 #include "lib/writer.h"
-#include "lib/queue_increasing.h"
-#include "decode_trie.h"
+#include "lib/thread_pool.h"
+#include "lib/crc32c.h"
+#include "lib/mapped_file.h"
+#include "lib/stats.h"
+#include "lib/histogram.h"
+#include "lib/lz77.h"
+#include "lib/xxhash64.h"
+#include "code_lengths.h"
+#include "block_format.h"
+#include "dictionary.h"
+#include "tans_coder.h"
 
-#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+
+namespace huffman {
+
+inline const size_t MAX_LZ_SEARCH_DEPTH = 1 << 16;
+
+enum class EntropyCoder {
+    Huffman,
+    Tans,
+    Smallest,  // Codes every block both ways and keeps the shorter one
+};
+
+struct EncoderOptions {
+    size_t max_code_length = 0;               // No limit if zero
+    size_t max_buffered_size = 64 * (1 << 20);  // Larger inputs are read twice
+    size_t block_size = 0;                      // Block archive with blocks of this size if not zero
+    size_t threads_count = 1;                   // Files or blocks are encoded in parallel if greater than one
+    size_t streams_count = 1;                   // Blocks are coded in this many interleaved streams, 1 or 4
+    EntropyCoder entropy_coder = EntropyCoder::Huffman;  // Anything but Huffman writes a block archive
+    size_t lz_search_depth = 0;  // Huffman blocks go through LZ77 looking this far back at most if not zero
+    bool deduplicate = false;    // Files with the same data as an earlier file are stored as its copies
+    std::vector<char> dictionary;  // Table of a dictionary file that codes every block if not empty
+    bool link_dictionary = false;  // The archive names the dictionary by its checksum instead of holding it
+    Stats *stats = nullptr;        // Receives the counters and phase times of every file if not null
+    size_t buffer_size = Reader::DEFAULT_FILE_BUFFER_BYTE_SIZE;  // Bytes of buffer for inputs that can't be mapped
+};
+
+};  // namespace huffman
 
 template <typename T = huffman::DEFAULT_CHAR_TYPE, size_t IN_CHAR_SIZE = huffman::DEFAULT_IN_CHAR_SIZE,
           size_t OUT_CHAR_SIZE = huffman::DEFAULT_OUT_CHAR_SIZE>
 class HuffmanEncoder {
-    using CharTrie = Trie<T, 2>;
+    using CanonicalOrder = std::vector<std::pair<size_t, T>>;
+    using Occurrences = std::vector<size_t>;  // Indexed by symbol
+
+    static_assert(IN_CHAR_SIZE == CHAR_BIT, "The encoder reads input bytes");
+    static_assert((size_t{1} << IN_CHAR_SIZE) + lz77::LENGTH_CODES_COUNT <= (size_t{1} << OUT_CHAR_SIZE),
+                  "Match length codes follow the bytes in the alphabet");
+
+    const static size_t READ_CHUNK_SIZE = 1 << 16;
+
+    // Bytes of a file that one task codes when a legacy archive is written on a pool, so the coded data
+    // in flight doesn't grow with the size of the files
+    const static size_t PIECE_SIZE = 1 << 20;
+
+    // Byte pairs are coded with a single lookup for inputs of at least this size
+    const static size_t PAIR_TABLE_MIN_SIZE = 1 << 18;
+    const static size_t PAIR_LENGTH_BITS = 6;
 
 public:
+    explicit HuffmanEncoder(huffman::EncoderOptions options = {}) : options_(options) {
+    }
+
     void EncodeFile(Reader &reader, Writer &writer, bool is_last = true) {
-        CharTrie trie = BuildTrie(reader);
-        trie = MakeCanonical(trie);
-        WriteEncoded(trie, reader, writer, is_last);
+        const size_t start_bits = writer.GetBitsWritten();
+        std::optional<std::vector<char>> buffered_data;
+        const std::string file_name = reader.GetFileName();
+        CanonicalOrder canonical_order = BuildCodeLengths(CountOccurrences(reader, buffered_data));
+        const size_t data_size = buffered_data ? buffered_data->size() : options_.max_buffered_size;
+        const CodeTable code_table = WriteHeader(canonical_order, file_name, data_size, writer);
+        if (buffered_data) {
+            WriteSymbols(code_table, *buffered_data, writer);
+        } else {
+            reader.Reload();
+            std::vector<char> chunk(READ_CHUNK_SIZE);
+            while (size_t chunk_size = reader.ReadBytes(chunk.data(), chunk.size())) {
+                WriteSymbols(code_table, std::span<const char>(chunk.data(), chunk_size), writer);
+            }
+        }
+        WriteEnd(code_table, writer, is_last);
+        Stats::Add(Stats::Counter::ArchiveBits, writer.GetBitsWritten() - start_bits);
+    }
+
+    // Regular files are mapped into memory and both passes read them in place, other inputs go through Reader
+    void EncodeFile(const std::string &file_name, Writer &writer, bool is_last = true) {
+        if (file_name != Reader::STANDARD_INPUT_NAME) {
+            MappedFile mapped_file(file_name);
+            if (mapped_file.IsMapped()) {
+                const size_t start_bits = writer.GetBitsWritten();
+                const std::span<const char> data(mapped_file.GetData(), mapped_file.GetSize());
+                const CodeTable code_table = WriteDataHeader(file_name, data, writer);
+                WriteSymbols(code_table, data, writer);
+                WriteEnd(code_table, writer, is_last);
+                Stats::Add(Stats::Counter::ArchiveBits, writer.GetBitsWritten() - start_bits);
+                return;
+            }
+        }
+        Reader reader(file_name, options_.buffer_size);
+        EncodeFile(reader, writer, is_last);
     }
 
     void EncodeFiles(const std::vector<std::string> &file_names, Writer &writer) {
+        Stats::Scope scope(options_.stats);
+        if (options_.block_size != 0) {
+            EncodeBlockArchive(file_names, writer, options_.block_size);
+            return;
+        }
+        if (options_.streams_count > 1 || options_.entropy_coder != huffman::EntropyCoder::Huffman ||
+            options_.lz_search_depth != 0 || options_.deduplicate || !options_.dictionary.empty()) {
+            EncodeBlockArchive(file_names, writer, huffman::block::DEFAULT_BLOCK_SIZE);
+            return;
+        }
+        // The standard input can't be read twice, so it is always compressed block by block
+        if (std::find(file_names.begin(), file_names.end(), Reader::STANDARD_INPUT_NAME) != file_names.end()) {
+            EncodeBlockArchive(file_names, writer, huffman::block::DEFAULT_BLOCK_SIZE);
+            return;
+        }
+        if (options_.threads_count <= 1) {
+            for (size_t i = 0; i < file_names.size(); ++i) {
+                Stats::Scope file_scope(options_.stats, AddStatsFile(file_names[i]));
+                EncodeFile(file_names[i], writer, (i + 1 == file_names.size()));
+            }
+            return;
+        }
+
+        // Headers are written here and the data of every file is coded in pieces on the pool. The codes don't
+        // depend on each other, so the bit strings of the pieces are concatenated in order
+        ThreadPool pool(options_.threads_count);
+        PendingChunks pending;
         for (size_t i = 0; i < file_names.size(); ++i) {
-            Reader reader(file_names[i]);
-            EncodeFile(reader, writer, (i + 1 == file_names.size()));
+            const bool is_last = (i + 1 == file_names.size());
+            Stats::Record *stats_file = AddStatsFile(file_names[i]);
+            Stats::Scope file_scope(options_.stats, stats_file);
+            auto mapped_file = std::make_shared<MappedFile>(file_names[i]);
+            if (!mapped_file->IsMapped()) {
+                Enqueue(pending, {}, writer, 0);  // Inputs that can't be mapped are coded here in order
+                EncodeFile(file_names[i], writer, is_last);
+                continue;
+            }
+            const std::span<const char> data(mapped_file->GetData(), mapped_file->GetSize());
+
+            EncodedChunk header;
+            std::shared_ptr<const CodeTable> code_table;
+            {
+                Writer header_writer(header.data);
+                code_table = std::make_shared<const CodeTable>(WriteDataHeader(file_names[i], data, header_writer));
+                header.number_bits = header_writer.GetBitsWritten();
+            }
+            Stats::Add(Stats::Counter::ArchiveBits, header.number_bits);
+            Enqueue(pending, Ready(std::move(header)), writer);
+
+            for (size_t offset = 0; offset < data.size(); offset += PIECE_SIZE) {
+                const std::span<const char> piece = data.subspan(offset, std::min(PIECE_SIZE, data.size() - offset));
+                Enqueue(pending, pool.Submit([this, piece, code_table, mapped_file, stats_file]() {
+                            Stats::Scope scope(options_.stats, stats_file);
+                            EncodedChunk chunk;
+                            {
+                                Writer chunk_writer(chunk.data);
+                                WriteSymbols(*code_table, piece, chunk_writer);
+                                chunk.number_bits = chunk_writer.GetBitsWritten();
+                            }
+                            Stats::Add(Stats::Counter::ArchiveBits, chunk.number_bits);
+                            return chunk;
+                        }),
+                        writer);
+            }
+
+            EncodedChunk end;
+            {
+                Writer end_writer(end.data);
+                WriteEnd(*code_table, end_writer, is_last);
+                end.number_bits = end_writer.GetBitsWritten();
+            }
+            Stats::Add(Stats::Counter::ArchiveBits, end.number_bits);
+            Enqueue(pending, Ready(std::move(end)), writer);
         }
+        Enqueue(pending, {}, writer, 0);
+    }
+
+    // Returns the table of a dictionary for data like the files. Every byte value gets a code, so that
+    // the dictionary can code any data
+    std::vector<char> TrainDictionary(const std::vector<std::string> &file_names) {
+        Occurrences character_occurrences(size_t{1} << OUT_CHAR_SIZE);
+        for (const auto &file_name : file_names) {
+            std::optional<MappedFile> mapped_file;
+            if (file_name != Reader::STANDARD_INPUT_NAME) {
+                mapped_file.emplace(file_name);
+            }
+            if (mapped_file && mapped_file->IsMapped()) {
+                AddByteOccurrences(std::span<const char>(mapped_file->GetData(), mapped_file->GetSize()),
+                                   character_occurrences);
+                continue;
+            }
+            Reader reader(file_name, options_.buffer_size);
+            std::vector<char> chunk(READ_CHUNK_SIZE);
+            while (size_t chunk_size = reader.ReadBytes(chunk.data(), chunk.size())) {
+                AddByteOccurrences(std::span<const char>(chunk.data(), chunk_size), character_occurrences);
+            }
+        }
+        std::vector<std::pair<size_t, T>> occurrences;
+        for (size_t character = 0; character < (size_t{1} << IN_CHAR_SIZE); ++character) {
+            occurrences.emplace_back(character_occurrences[character] + 1, static_cast<T>(character));
+        }
+        const CanonicalOrder canonical_order =
+            LimitedCodeLengths(std::move(occurrences), huffman::dictionary::MAX_CODE_LENGTH);
+
+        std::vector<char> table;
+        {
+            Writer table_writer(table);
+            WriteHuffmanData(canonical_order, table_writer);
+        }
+        return table;
     }
 
 private:
-    struct PriorityElement {
-        CharTrie trie;
-        size_t number_occurrences;
-        T character;
+    struct EncodedChunk {
+        std::vector<char> data = {};
+        size_t number_bits = 0;
+        uint64_t *offset = nullptr;  // Receives the byte offset of the chunk in the archive when it is written
+    };
+
+    using PendingChunks = std::deque<std::future<EncodedChunk>>;
+
+    struct Code {
+        uint64_t bits = 0;
+        size_t length = 0;
+    };
+
+    struct CodeTable {
+        std::vector<Code> codes;  // Indexed by symbol
+        // Indexed by (first << CHAR_BIT) | second, (bits << PAIR_LENGTH_BITS) | length of both codes or zero if
+        // they don't fit into one write. Empty for small inputs
+        std::vector<uint64_t> pair_codes;
     };
 
-    struct PriorityElementComparator {
-        bool operator()(const PriorityElement &left, const PriorityElement &right) const {
-            return std::tie(left.number_occurrences, left.character) <
-                   std::tie(right.number_occurrences, right.character);
+    huffman::EncoderOptions options_;
+    std::optional<CodeTable> dictionary_codes_;  // Codes of the dictionary while a block archive is written
+
+    Stats::Record *AddStatsFile(const std::string &file_name) {
+        return options_.stats != nullptr ? &options_.stats->AddFile(file_name) : nullptr;
+    }
+
+    static std::future<EncodedChunk> Ready(EncodedChunk chunk) {
+        std::promise<EncodedChunk> promise;
+        promise.set_value(std::move(chunk));
+        return promise.get_future();
+    }
+
+    // Keeps a bounded number of chunks in flight and writes the finished ones in submission order
+    void Enqueue(PendingChunks &pending, std::future<EncodedChunk> chunk, Writer &writer) {
+        Enqueue(pending, std::move(chunk), writer, 2 * std::max<size_t>(options_.threads_count, 1));
+    }
+
+    void Enqueue(PendingChunks &pending, std::future<EncodedChunk> chunk, Writer &writer, size_t max_pending) {
+        if (chunk.valid()) {
+            pending.push_back(std::move(chunk));
+        }
+        while (pending.size() > max_pending) {
+            EncodedChunk ready = pending.front().get();
+            pending.pop_front();
+            if (ready.offset != nullptr) {
+                *ready.offset = writer.GetBitsWritten() / CHAR_BIT;
+            }
+            writer.AppendBits(ready.data.data(), ready.number_bits);
         }
-    } comparator_;
+    }
 
-    std::unordered_map<T, size_t> CountOccurrences(Reader &reader) {
-        std::unordered_map<T, size_t> character_occurrences;
-        for (const T &ch : reader.GetFileName()) {
-            ++character_occurrences[ch];
+    // Reads the whole input once. It is kept in buffered_data unless it exceeds max_buffered_size
+    Occurrences CountOccurrences(Reader &reader, std::optional<std::vector<char>> &buffered_data) {
+        Occurrences character_occurrences = CountServiceOccurrences(reader.GetFileName());
+
+        buffered_data.emplace();
+        std::vector<char> chunk(READ_CHUNK_SIZE);
+        while (size_t chunk_size = reader.ReadBytes(chunk.data(), chunk.size())) {
+            Stats::Add(Stats::Counter::RawBytes, chunk_size);
+            AddByteOccurrences(std::span<const char>(chunk.data(), chunk_size), character_occurrences);
+            if (buffered_data && buffered_data->size() + chunk_size > options_.max_buffered_size) {
+                buffered_data.reset();
+            }
+            if (buffered_data) {
+                buffered_data->insert(buffered_data->end(), chunk.begin(), chunk.begin() + chunk_size);
+            }
         }
+        return character_occurrences;
+    }
 
-        while (!reader.IsEof()) {
-            T value = reader.ReadBits<T>(IN_CHAR_SIZE);
-            ++character_occurrences[value];
+    // Occurrences of the file name characters and of the symbols that end names and files
+    static Occurrences CountServiceOccurrences(const std::string &file_name) {
+        Occurrences character_occurrences(size_t{1} << OUT_CHAR_SIZE);
+        for (unsigned char ch : file_name) {
+            ++character_occurrences[ch];
         }
         character_occurrences[huffman::FILENAME_END] = 1;
         character_occurrences[huffman::ONE_MORE_FILE] = 1;
         character_occurrences[huffman::ARCHIVE_END] = 1;
-        reader.Reload();
         return character_occurrences;
     }
 
-    CharTrie BuildTrie(Reader &reader) {
-        QueueTwoIncreasing<PriorityElement, PriorityElementComparator> queue;
+    static void AddByteOccurrences(std::span<const char> data, Occurrences &character_occurrences) {
+        Stats::PhaseTimer timer(Stats::Phase::Counting);
+        ByteHistogram histogram = {};
+        CountBytes(data.data(), data.size(), histogram);
+        for (size_t value = 0; value < histogram.size(); ++value) {
+            character_occurrences[value] += histogram[value];
+        }
+    }
 
-        std::vector<PriorityElement> init_elements;
-        for (auto [character, occurrences] : CountOccurrences(reader)) {
-            CharTrie trie;
-            trie.Insert(std::vector<size_t>{}, character);  // Make only root terminal (path length = 0)
-            init_elements.push_back(
-                {.trie = std::move(trie), .number_occurrences = occurrences, .character = character});
+    CanonicalOrder BuildCodeLengths(const Occurrences &character_occurrences) {
+        Stats::PhaseTimer timer(Stats::Phase::TableBuild);
+        std::vector<std::pair<size_t, T>> occurrences;
+        for (size_t character = 0; character < character_occurrences.size(); ++character) {
+            if (character_occurrences[character] != 0) {
+                occurrences.emplace_back(character_occurrences[character], static_cast<T>(character));
+            }
+        }
+        CanonicalOrder canonical_order = HuffmanCodeLengths(occurrences);
+        if (options_.max_code_length != 0 && !canonical_order.empty() &&
+            canonical_order.back().first > options_.max_code_length) {
+            canonical_order = LimitedCodeLengths(std::move(occurrences), options_.max_code_length);
         }
-        std::sort(init_elements.begin(), init_elements.end(), comparator_);
+        return canonical_order;
+    }
 
-        for (auto &element : init_elements) {
-            queue.Push(std::move(element));
+    void WriteHuffmanData(const CanonicalOrder &canonical_order, Writer &writer) {
+        const size_t symbols_count = canonical_order.size();
+        writer.WriteBits(symbols_count, OUT_CHAR_SIZE);
+
+        std::vector<size_t> number_symbol_with_code_size(1);
+
+        for (const auto &[code_length, character] : canonical_order) {
+            writer.WriteBits(character, OUT_CHAR_SIZE);
+
+            if (number_symbol_with_code_size.size() <= code_length) {
+                number_symbol_with_code_size.resize(code_length + 1);
+            }
+            ++number_symbol_with_code_size[code_length];
         }
 
-        while (queue.Size() > 1) {
-            PriorityElement element1(queue.ExtractMin());
-            PriorityElement element2(queue.ExtractMin());
-            queue.Push({.trie = CharTrie::Merge(element1.trie, element2.trie),
-                        .number_occurrences = element1.number_occurrences + element2.number_occurrences,
-                        .character = std::min(element1.character, element2.character)});
+        for (size_t i = 1; i < number_symbol_with_code_size.size(); ++i) {
+            writer.WriteBits(number_symbol_with_code_size[i], OUT_CHAR_SIZE);
         }
+    }
 
-        CharTrie trie(queue.ExtractMin().trie);
-        return trie;
+    CodeTable BuildCodeTable(const CanonicalOrder &canonical_order, size_t data_size) {
+        Stats::PhaseTimer timer(Stats::Phase::TableBuild);
+        Stats::Add(Stats::Counter::Tables, 1);
+        CodeTable code_table;
+        code_table.codes.resize(size_t{1} << OUT_CHAR_SIZE);
+        const std::vector<uint64_t> codes = CanonicalCodes(canonical_order);
+        for (size_t i = 0; i < canonical_order.size(); ++i) {
+            const auto &[code_length, character] = canonical_order[i];
+            code_table.codes[character] = {.bits = codes[i], .length = code_length};
+        }
+
+        if (data_size >= PAIR_TABLE_MIN_SIZE) {
+            const size_t byte_values = size_t{1} << IN_CHAR_SIZE;
+            code_table.pair_codes.resize(byte_values * byte_values);
+            for (size_t first = 0; first < byte_values; ++first) {
+                const Code &first_code = code_table.codes[first];
+                for (size_t second = 0; second < byte_values; ++second) {
+                    const Code &second_code = code_table.codes[second];
+                    const size_t length = first_code.length + second_code.length;
+                    if (length != 0 && length <= Writer::MAX_WRITE_BITS) {
+                        const uint64_t bits = (first_code.bits << second_code.length) | second_code.bits;
+                        code_table.pair_codes[(first << IN_CHAR_SIZE) | second] = (bits << PAIR_LENGTH_BITS) | length;
+                    }
+                }
+            }
+        }
+        return code_table;
+    }
+
+    // Counts the symbols of data and writes the header of its file, returns the codes for the data
+    CodeTable WriteDataHeader(const std::string &file_name, std::span<const char> data, Writer &writer) {
+        Stats::Add(Stats::Counter::RawBytes, data.size());
+        Occurrences character_occurrences = CountServiceOccurrences(file_name);
+        AddByteOccurrences(data, character_occurrences);
+        const CanonicalOrder canonical_order = BuildCodeLengths(character_occurrences);
+        return WriteHeader(canonical_order, file_name, data.size(), writer);
     }
 
-    CharTrie MakeCanonical(CharTrie &trie) {
-        std::vector<std::pair<size_t, T>> canonical_order;
-        for (const auto &[code, character] : trie.GetTerminals()) {
-            canonical_order.emplace_back(code.size(), character);
+    // Writes the table and the file name, returns the codes for the rest of the file
+    CodeTable WriteHeader(const CanonicalOrder &canonical_order, const std::string &file_name, size_t data_size,
+                          Writer &writer) {
+        WriteHuffmanData(canonical_order, writer);
+
+        CodeTable code_table = BuildCodeTable(canonical_order, data_size);
+
+        for (unsigned char ch : file_name) {
+            WriteCode(code_table.codes[ch], writer);
         }
-        std::sort(canonical_order.begin(), canonical_order.end());
+        WriteCode(code_table.codes[huffman::FILENAME_END], writer);
+        return code_table;
+    }
 
-        return DecodeTrie(canonical_order);
+    static void WriteCode(const Code &code, Writer &writer) {
+        writer.WriteBits(code.bits, code.length);
     }
 
-    void WriteHuffmanData(CharTrie &trie, Writer &writer) {
-        const size_t symbols_count = trie.GetNumberOfTerminals();
-        writer.WriteBits(symbols_count, OUT_CHAR_SIZE);
+    static void WriteSymbols(const CodeTable &code_table, std::span<const char> data, Writer &writer) {
+        Stats::PhaseTimer timer(Stats::Phase::Coding);
+        Stats::Add(Stats::Counter::Symbols, data.size());
+        size_t i = 0;
+        if (!code_table.pair_codes.empty()) {
+            for (; i + 2 <= data.size(); i += 2) {
+                const size_t pair = (static_cast<size_t>(static_cast<unsigned char>(data[i])) << IN_CHAR_SIZE) |
+                                    static_cast<unsigned char>(data[i + 1]);
+                if (const uint64_t pair_code = code_table.pair_codes[pair]) {
+                    writer.WriteBits(pair_code >> PAIR_LENGTH_BITS, pair_code & ((1 << PAIR_LENGTH_BITS) - 1));
+                } else {
+                    WriteCode(code_table.codes[static_cast<unsigned char>(data[i])], writer);
+                    WriteCode(code_table.codes[static_cast<unsigned char>(data[i + 1])], writer);
+                }
+            }
+        }
+        for (; i < data.size(); ++i) {
+            WriteCode(code_table.codes[static_cast<unsigned char>(data[i])], writer);
+        }
+    }
 
-        std::vector<size_t> number_symbol_with_code_size(1);
+    // Codes consecutive parts of data into separate byte-aligned streams preceded by their sizes
+    static void WriteStreams(const CodeTable &code_table, std::span<const char> data, Writer &writer) {
+        writer.AlignToByte();
+        const size_t part_size = (data.size() + huffman::block::STREAMS_COUNT - 1) / huffman::block::STREAMS_COUNT;
+        std::array<std::vector<char>, huffman::block::STREAMS_COUNT> streams;
+        for (size_t i = 0; i < streams.size(); ++i) {
+            Writer stream_writer(streams[i]);
+            const size_t begin = std::min(i * part_size, data.size());
+            WriteSymbols(code_table, data.subspan(begin, std::min(part_size, data.size() - begin)), stream_writer);
+        }
+        for (size_t i = 0; i + 1 < streams.size(); ++i) {
+            writer.WriteBits(streams[i].size(), huffman::block::SIZE_FIELD_SIZE);
+        }
+        for (const auto &stream : streams) {
+            writer.WriteBytes(stream.data(), stream.size());
+        }
+    }
 
-        for (const auto &[code, character] : trie.GetTerminals()) {
-            writer.WriteBits(character, OUT_CHAR_SIZE);
+    static void WriteEnd(const CodeTable &code_table, Writer &writer, bool is_last) {
+        if (is_last) {
+            WriteCode(code_table.codes[huffman::ARCHIVE_END], writer);
+        } else {
+            WriteCode(code_table.codes[huffman::ONE_MORE_FILE], writer);
+        }
+    }
+
+    void EncodeBlockArchive(const std::vector<std::string> &file_names, Writer &writer, size_t block_size) {
+        const size_t header_start_bits = writer.GetBitsWritten();
+        writer.WriteBits(huffman::block::MAGIC, huffman::block::MAGIC_SIZE);
+        writer.WriteBits(huffman::block::VERSION, huffman::block::VERSION_SIZE);
+        writer.WriteBits(block_size, huffman::block::SIZE_FIELD_SIZE);
+        WriteDictionary(writer);
+        Stats::Add(Stats::Counter::ArchiveBits, writer.GetBitsWritten() - header_start_bits);
+
+        // Only blocks are encoded in the pool, so the archive doesn't depend on the number of threads
+        ThreadPool pool(options_.threads_count > 1 ? options_.threads_count : 0);
+        PendingChunks pending;
+        std::vector<huffman::block::DirectoryEntry> directory(file_names.size());
+        // Members that later files can be copies of by their sizes and hashes
+        std::map<std::pair<uint64_t, uint64_t>, size_t> sources;
+        std::map<std::string, std::pair<uint64_t, uint64_t>> source_keys;  // Keys of the sources by their names
+        for (size_t i = 0; i < file_names.size(); ++i) {
+            huffman::block::DirectoryEntry &entry = directory[i];
+            entry.name = file_names[i];
+            Stats::Record *stats_file = AddStatsFile(entry.name);
+            Stats::Scope file_scope(options_.stats, stats_file);
+            // A later file with the same name overwrites the source when extracted
+            if (auto replaced = source_keys.find(entry.name); replaced != source_keys.end()) {
+                sources.erase(replaced->second);
+                source_keys.erase(replaced);
+            }
+            auto mapped_file = entry.name != Reader::STANDARD_INPUT_NAME ? std::make_shared<MappedFile>(entry.name)
+                                                                          : nullptr;
+            // An empty member is smaller than a copy
+            if (options_.deduplicate && mapped_file && mapped_file->IsMapped() && mapped_file->GetSize() != 0) {
+                const std::pair<uint64_t, uint64_t> key(mapped_file->GetSize(),
+                                                        Xxh64(mapped_file->GetData(), mapped_file->GetSize()));
+                auto source = sources.find(key);
+                // The checksum makes a false match of the hashes yet less likely
+                if (source != sources.end() &&
+                    Crc32c(mapped_file->GetData(), mapped_file->GetSize()) == directory[source->second].checksum) {
+                    entry.raw_size = directory[source->second].raw_size;
+                    entry.checksum = directory[source->second].checksum;
+                    EncodedChunk member_copy{.offset = &entry.offset};
+                    {
+                        Writer copy_writer(member_copy.data);
+                        copy_writer.WriteBits(huffman::block::MEMBER_COPY, huffman::block::TAG_SIZE);
+                        copy_writer.WriteBits(entry.name.size(), huffman::block::NAME_LENGTH_SIZE);
+                        copy_writer.WriteBytes(entry.name.data(), entry.name.size());
+                        copy_writer.WriteBits(source->second, huffman::block::MEMBER_NUMBER_SIZE);
+                    }
+                    member_copy.number_bits = member_copy.data.size() * CHAR_BIT;
+                    Stats::Add(Stats::Counter::ArchiveBits, member_copy.number_bits);
+                    Enqueue(pending, Ready(std::move(member_copy)), writer);
+                    continue;
+                }
+                sources.emplace(key, i);
+                source_keys.emplace(entry.name, key);
+            }
 
-            if (number_symbol_with_code_size.size() <= code.size()) {
-                number_symbol_with_code_size.resize(code.size() + 1);
+            EncodedChunk member_header{.offset = &entry.offset};
+            {
+                Writer header_writer(member_header.data);
+                header_writer.WriteBits(huffman::block::MEMBER, huffman::block::TAG_SIZE);
+                header_writer.WriteBits(entry.name.size(), huffman::block::NAME_LENGTH_SIZE);
+                header_writer.WriteBytes(entry.name.data(), entry.name.size());
             }
-            ++number_symbol_with_code_size[code.size()];
+            member_header.number_bits = member_header.data.size() * CHAR_BIT;
+            Stats::Add(Stats::Counter::ArchiveBits, member_header.number_bits + CHAR_BIT);  // With MEMBER_END
+            Enqueue(pending, Ready(std::move(member_header)), writer);
+
+            // owner keeps the memory of a block alive until the block is encoded
+            auto submit_block = [&](std::span<const char> block, std::shared_ptr<const void> owner) {
+                const uint32_t checksum = Crc32c(block.data(), block.size());
+                entry.raw_size += block.size();
+                entry.checksum = Crc32cCombine(entry.checksum, checksum, block.size());
+                Stats::Add(Stats::Counter::RawBytes, block.size());
+                Enqueue(pending, pool.Submit([this, block, checksum, owner, stats_file]() {
+                            Stats::Scope scope(options_.stats, stats_file);
+                            return EncodeBlock(block, checksum);
+                        }),
+                        writer);
+            };
+            if (mapped_file && mapped_file->IsMapped()) {
+                for (size_t offset = 0; offset < mapped_file->GetSize(); offset += block_size) {
+                    const size_t size = std::min(block_size, mapped_file->GetSize() - offset);
+                    submit_block(std::span<const char>(mapped_file->GetData() + offset, size), mapped_file);
+                }
+            } else {
+                Reader reader(entry.name, options_.buffer_size);
+                while (true) {
+                    auto block = std::make_shared<std::vector<char>>(block_size);
+                    block->resize(reader.ReadBytes(block->data(), block->size()));
+                    if (block->empty()) {
+                        break;
+                    }
+                    submit_block(*block, block);
+                }
+            }
+
+            EncodedChunk member_end{.data = {static_cast<char>(huffman::block::MEMBER_END)}, .number_bits = CHAR_BIT};
+            Enqueue(pending, Ready(std::move(member_end)), writer);
         }
+        Enqueue(pending, {}, writer, 0);
+        const size_t end_start_bits = writer.GetBitsWritten();
+        writer.WriteBits(huffman::block::ARCHIVE_END, huffman::block::TAG_SIZE);
+        WriteDirectory(directory, writer);
+        Stats::Add(Stats::Counter::ArchiveBits, writer.GetBitsWritten() - end_start_bits);
+    }
 
-        for (size_t i = 1; i < number_symbol_with_code_size.size(); ++i) {
-            writer.WriteBits(number_symbol_with_code_size[i], OUT_CHAR_SIZE);
+    void WriteDictionary(Writer &writer) {
+        const std::vector<char> &table = options_.dictionary;
+        if (table.empty()) {
+            dictionary_codes_.reset();
+            writer.WriteBits(huffman::block::NO_DICTIONARY, huffman::block::DICTIONARY_KIND_SIZE);
+            return;
+        }
+        // Every block uses the codes, so byte pairs are worth a table whatever the size of the files
+        dictionary_codes_ = BuildCodeTable(ReadDictionaryOrder(table), PAIR_TABLE_MIN_SIZE);
+        if (options_.link_dictionary) {
+            writer.WriteBits(huffman::block::LINKED_DICTIONARY, huffman::block::DICTIONARY_KIND_SIZE);
+            writer.WriteBits(Crc32c(table.data(), table.size()), huffman::block::CHECKSUM_SIZE);
+        } else {
+            writer.WriteBits(huffman::block::EMBEDDED_DICTIONARY, huffman::block::DICTIONARY_KIND_SIZE);
+            writer.WriteBits(table.size(), huffman::block::SIZE_FIELD_SIZE);
+            writer.WriteBytes(table.data(), table.size());
+        }
+    }
+
+    // The table must be a prefix code with a code for every byte value and nothing else, otherwise
+    // throws Reader::FileReadError
+    static CanonicalOrder ReadDictionaryOrder(const std::vector<char> &table) {
+        Reader reader(table);
+        const size_t symbols_count = reader.ReadBits<size_t>(OUT_CHAR_SIZE);
+        CanonicalOrder canonical_order(symbols_count);
+        std::vector<bool> has_code(size_t{1} << IN_CHAR_SIZE);
+        for (auto &[code_length, character] : canonical_order) {
+            character = reader.ReadBits<T>(OUT_CHAR_SIZE);
+            if (character >= has_code.size() || has_code[character]) {
+                throw Reader::FileReadError();
+            }
+            has_code[character] = true;
+        }
+        if (symbols_count != has_code.size()) {
+            throw Reader::FileReadError();
+        }
+        // Kraft sum of the codes in units of the longest allowed code
+        uint64_t kraft_sum = 0;
+        size_t current_symbol = 0;
+        for (size_t code_length = 1; current_symbol < symbols_count; ++code_length) {
+            const size_t symbols_with_length = reader.ReadBits<size_t>(OUT_CHAR_SIZE);
+            if (code_length > huffman::MAX_CODE_LENGTH_LIMIT || symbols_with_length > symbols_count - current_symbol) {
+                throw Reader::FileReadError();
+            }
+            for (size_t i = 0; i < symbols_with_length; ++i) {
+                canonical_order[current_symbol++].first = code_length;
+                kraft_sum += uint64_t{1} << (huffman::MAX_CODE_LENGTH_LIMIT - code_length);
+                if (kraft_sum > uint64_t{1} << huffman::MAX_CODE_LENGTH_LIMIT) {
+                    throw Reader::FileReadError();
+                }
+            }
         }
+        return canonical_order;
     }
 
-    void WriteEncoded(CharTrie &trie, Reader &reader, Writer &writer, bool is_last = true) {
-        WriteHuffmanData(trie, writer);
+    // Returns the codec of the payload. canonical_order has the code lengths of the block bytes, LZ77
+    // payloads build their own codes and ignore it
+    uint8_t EncodeHuffmanPayload(std::span<const char> block, const CanonicalOrder &canonical_order,
+                                 std::vector<char> &payload) {
+        if (options_.lz_search_depth != 0) {
+            EncodeLzPayload(block, payload);
+            return huffman::block::CODEC_LZ_HUFFMAN;
+        }
+        const CodeTable code_table = BuildCodeTable(canonical_order, block.size());
 
-        std::unordered_map<T, std::vector<bool>> char_code;
-        for (const auto &[code, character] : trie.GetTerminals()) {
-            std::vector<bool> bool_code(code.begin(), code.end());
-            char_code[character] = bool_code;
+        Writer payload_writer(payload);
+        WriteHuffmanData(canonical_order, payload_writer);
+        if (options_.streams_count == huffman::block::STREAMS_COUNT) {
+            WriteStreams(code_table, block, payload_writer);
+            return huffman::block::CODEC_HUFFMAN_4_STREAMS;
         }
+        WriteSymbols(code_table, block, payload_writer);
+        return huffman::block::CODEC_HUFFMAN;
+    }
 
-        for (const T &ch : reader.GetFileName()) {
-            writer.WriteBits(char_code[ch]);
+    CanonicalOrder BuildBlockCodeLengths(const ByteHistogram &histogram) {
+        Occurrences character_occurrences(size_t{1} << OUT_CHAR_SIZE);
+        std::copy(histogram.begin(), histogram.end(), character_occurrences.begin());
+        return BuildBlockCodeLengths(character_occurrences);
+    }
+
+    CanonicalOrder BuildBlockCodeLengths(const Occurrences &occurrences) {
+        CanonicalOrder canonical_order = BuildCodeLengths(occurrences);
+        if (canonical_order.size() == 1) {
+            canonical_order.front().first = 1;  // A code can't be empty
         }
-        writer.WriteBits(char_code[huffman::FILENAME_END]);
+        return canonical_order;
+    }
+
+    void EncodeLzPayload(std::span<const char> block, std::vector<char> &payload) {
+        const std::vector<LzMatch> matches = [&] {
+            Stats::PhaseTimer timer(Stats::Phase::Matching);
+            return FindMatches(block, options_.lz_search_depth);
+        }();
+        Stats::Add(Stats::Counter::Symbols, matches.size());
+        const size_t byte_values = size_t{1} << IN_CHAR_SIZE;
 
-        while (!reader.IsEof()) {
-            T value = reader.ReadBits<T>(IN_CHAR_SIZE);
-            writer.WriteBits(char_code[value]);
+        Occurrences symbol_occurrences(size_t{1} << OUT_CHAR_SIZE);
+        Occurrences distance_occurrences(lz77::DISTANCE_CODES_COUNT);
+        size_t position = 0;
+        size_t literals_count = 0;
+        {
+            // Literal runs are mostly short, so they are counted in place rather than through a histogram each
+            Stats::PhaseTimer timer(Stats::Phase::Counting);
+            auto add_literals = [&](size_t end) {
+                for (; position < end; ++position) {
+                    ++symbol_occurrences[static_cast<unsigned char>(block[position])];
+                }
+            };
+            for (const LzMatch &match : matches) {
+                literals_count += match.position - position;
+                add_literals(match.position);
+                ++symbol_occurrences[byte_values + lz77::SplitValue(match.length - lz77::MIN_MATCH).code];
+                ++distance_occurrences[lz77::SplitValue(match.distance - 1).code];
+                position = match.position + match.length;
+            }
+            literals_count += block.size() - position;
+            add_literals(block.size());
         }
-        if (is_last) {
-            writer.WriteBits(char_code[huffman::ARCHIVE_END]);
+
+        const CanonicalOrder symbol_order = BuildBlockCodeLengths(symbol_occurrences);
+        const CanonicalOrder distance_order = BuildBlockCodeLengths(distance_occurrences);
+        // Only literals are coded through the pair table
+        const CodeTable symbol_codes = BuildCodeTable(symbol_order, literals_count);
+        const CodeTable distance_codes = BuildCodeTable(distance_order, 0);
+
+        Writer payload_writer(payload);
+        WriteHuffmanData(symbol_order, payload_writer);
+        WriteHuffmanData(distance_order, payload_writer);
+        position = 0;
+        for (const LzMatch &match : matches) {
+            WriteSymbols(symbol_codes, block.subspan(position, match.position - position), payload_writer);
+            const lz77::ValueCode length = lz77::SplitValue(match.length - lz77::MIN_MATCH);
+            WriteCode(symbol_codes.codes[byte_values + length.code], payload_writer);
+            payload_writer.WriteBits(length.extra_bits, length.extra_bits_count);
+            const lz77::ValueCode distance = lz77::SplitValue(match.distance - 1);
+            WriteCode(distance_codes.codes[distance.code], payload_writer);
+            payload_writer.WriteBits(distance.extra_bits, distance.extra_bits_count);
+            position = match.position + match.length;
+        }
+        WriteSymbols(symbol_codes, block.subspan(position), payload_writer);
+    }
+
+    void WriteDirectory(const std::vector<huffman::block::DirectoryEntry> &directory, Writer &writer) {
+        const uint64_t directory_offset = writer.GetBitsWritten() / CHAR_BIT;
+        writer.WriteBits(directory.size(), huffman::block::COUNT_SIZE);
+        for (const auto &entry : directory) {
+            writer.WriteBits(entry.name.size(), huffman::block::NAME_LENGTH_SIZE);
+            writer.WriteBytes(entry.name.data(), entry.name.size());
+            writer.WriteBits(entry.raw_size, huffman::block::LONG_SIZE_FIELD_SIZE);
+            writer.WriteBits(entry.offset, huffman::block::LONG_SIZE_FIELD_SIZE);
+            writer.WriteBits(entry.checksum, huffman::block::CHECKSUM_SIZE);
+        }
+        writer.WriteBits(directory_offset, huffman::block::LONG_SIZE_FIELD_SIZE);
+        writer.WriteBits(huffman::block::MAGIC, huffman::block::MAGIC_SIZE);
+    }
+
+    // Size of the Huffman payload with the code lengths for the histogram in bytes. tANS can't save more
+    // than a bit per byte against it, which is too little to make up for its table on data that Huffman
+    // codes don't shrink
+    static size_t EstimateHuffmanSize(const CanonicalOrder &canonical_order, const ByteHistogram &histogram) {
+        size_t bits = OUT_CHAR_SIZE * (1 + canonical_order.size() + canonical_order.back().first);
+        for (const auto &[code_length, character] : canonical_order) {
+            bits += code_length * histogram[character];
+        }
+        return (bits + CHAR_BIT - 1) / CHAR_BIT;
+    }
+
+    // Returns the codec of the payload, canonical_order is the same as in EncodeHuffmanPayload
+    uint8_t EncodeEntropyPayload(std::span<const char> block, const ByteHistogram &histogram,
+                                 const CanonicalOrder &canonical_order, std::vector<char> &payload) {
+        uint8_t codec = huffman::block::CODEC_HUFFMAN;
+        if (options_.entropy_coder != huffman::EntropyCoder::Tans) {
+            codec = EncodeHuffmanPayload(block, canonical_order, payload);
+        }
+        if (options_.entropy_coder != huffman::EntropyCoder::Huffman) {
+            std::vector<char> tans_payload;
+            {
+                Writer payload_writer(tans_payload);
+                const TansEncoder encoder = [&] {
+                    Stats::PhaseTimer timer(Stats::Phase::TableBuild);
+                    Stats::Add(Stats::Counter::Tables, 1);
+                    return TansEncoder(histogram);
+                }();
+                encoder.WriteTable(payload_writer);
+                Stats::PhaseTimer timer(Stats::Phase::Coding);
+                Stats::Add(Stats::Counter::Symbols, block.size());
+                encoder.Encode(block, payload_writer);
+            }
+            if (options_.entropy_coder == huffman::EntropyCoder::Tans || tans_payload.size() < payload.size()) {
+                codec = huffman::block::CODEC_TANS;
+                payload = std::move(tans_payload);
+            }
+        }
+        return codec;
+    }
+
+    // Blocks that the codes would not shrink are stored as they are. The codes of a dictionary are known
+    // in advance, so its blocks are coded without counting their bytes
+    EncodedChunk EncodeBlock(std::span<const char> block, uint32_t checksum) {
+        uint8_t codec = huffman::block::CODEC_STORED;
+        std::vector<char> payload;
+        if (dictionary_codes_) {
+            {
+                Writer payload_writer(payload);
+                WriteSymbols(*dictionary_codes_, block, payload_writer);
+            }
+            codec = huffman::block::CODEC_DICTIONARY_HUFFMAN;
         } else {
-            writer.WriteBits(char_code[huffman::ONE_MORE_FILE]);
+            ByteHistogram histogram = {};
+            {
+                Stats::PhaseTimer timer(Stats::Phase::Counting);
+                CountBytes(block.data(), block.size(), histogram);
+            }
+            // Matches can shrink data with flat byte counts, so LZ77 blocks are only checked after coding
+            if (!block.empty() && options_.lz_search_depth != 0) {
+                codec = EncodeEntropyPayload(block, histogram, {}, payload);
+            } else if (!block.empty()) {
+                // The code lengths of the estimate also code the block
+                const CanonicalOrder canonical_order = BuildBlockCodeLengths(histogram);
+                if (EstimateHuffmanSize(canonical_order, histogram) < block.size()) {
+                    codec = EncodeEntropyPayload(block, histogram, canonical_order, payload);
+                }
+            }
+        }
+        if (payload.size() >= block.size()) {
+            codec = huffman::block::CODEC_STORED;
+        }
+        const std::span<const char> payload_data = codec == huffman::block::CODEC_STORED ? block : payload;
+
+        EncodedChunk chunk;
+        {
+            Writer chunk_writer(chunk.data);
+            chunk_writer.WriteBits(codec, huffman::block::CODEC_SIZE);
+            chunk_writer.WriteBits(block.size(), huffman::block::SIZE_FIELD_SIZE);
+            chunk_writer.WriteBits(payload_data.size(), huffman::block::SIZE_FIELD_SIZE);
+            chunk_writer.WriteBits(checksum, huffman::block::CHECKSUM_SIZE);
+            chunk_writer.WriteBytes(payload_data.data(), payload_data.size());
         }
-        reader.Reload();
+        chunk.number_bits = chunk.data.size() * CHAR_BIT;
+        Stats::Add(Stats::Counter::Blocks, 1);
+        Stats::Add(Stats::Counter::ArchiveBits, chunk.number_bits);
+        return chunk;
     }
-};
\ No newline at end of file
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <vector>
 #include <sstream>
@@ -40,6 +42,7 @@ private:
         virtual bool CanSet() const = 0;
         virtual bool Set(const std::string& value) = 0;
         virtual bool IsRequired() const = 0;
+        virtual bool IsFlag() const = 0;
 
         virtual const std::string& GetShortName() const = 0;
         virtual const std::string& GetLongName() const = 0;
@@ -60,6 +63,7 @@ private:
         bool CanSet() const override;
         bool Set(const std::string& value) override;
         bool IsRequired() const override;
+        bool IsFlag() const override;
 
         const std::string& GetShortName() const override;
         const std::string& GetLongName() const override;
@@ -84,6 +88,7 @@ private:
 
         bool CanSet() const override;
         bool Set(const std::string& value) override;
+        bool IsFlag() const override;
     };
 
     template <typename T>
@@ -171,7 +176,7 @@ bool CLAParser::ArgumentHolder<T>::Set(const std::string& value) {
     } catch (const InvalidArgumentCastException& e) {
         return false;
     }
-    return false;
+    return true;
 }
 
 template <typename T>
@@ -179,6 +184,11 @@ bool CLAParser::ArgumentHolder<T>::IsRequired() const {
     return required_;
 }
 
+template <typename T>
+bool CLAParser::ArgumentHolder<T>::IsFlag() const {
+    return false;
+}
+
 template <typename T>
 const std::string& CLAParser::ArgumentHolder<T>::GetShortName() const {
     return short_name_;
@@ -226,6 +236,10 @@ bool CLAParser::FlagHolder::Set(const std::string& value) {
     return true;
 }
 
+bool CLAParser::FlagHolder::IsFlag() const {
+    return true;
+}
+
 template <typename T>
 CLAParser::MultiplyArgumentsHolder<T>::MultiplyArgumentsHolder(const std::string& type, const std::string& help,
                                                                size_t required)
@@ -308,12 +322,15 @@ bool CLAParser::Parse(int argc, char** argv) {
             for (size_t j = 2; j <= current.size(); ++j) {
                 if (j == current.size() || current[j] == '=') {
                     long_name = current.substr(2, j - 2);
-                    value = static_cast<std::string>(current.substr(j));
+                    value = static_cast<std::string>(current.substr(std::min(j + 1, current.size())));
                     break;
                 }
             }
             for (auto& arg : args_) {
                 if (arg->GetLongName() == long_name) {
+                    if (value.empty() && !arg->IsFlag() && i + 1 < static_cast<size_t>(argc)) {
+                        value = argv[++i];
+                    }
                     if (!arg->Set(value)) {
                         return false;
                     }
@@ -321,14 +338,14 @@ bool CLAParser::Parse(int argc, char** argv) {
                     break;
                 }
             }
-        } else if (!current.empty() && current.substr(0, 1) == "-") {
-            if (current.size() < 2) {
-                return false;
-            }
+        } else if (current.size() >= 2 && current.substr(0, 1) == "-") {
             std::string short_name(1, current[1]);
             std::string value = static_cast<std::string>(current.substr(2));
             for (auto& arg : args_) {
                 if (arg->GetShortName() == short_name) {
+                    if (value.empty() && !arg->IsFlag() && i + 1 < static_cast<size_t>(argc)) {
+                        value = argv[++i];
+                    }
                     if (!arg->Set(value)) {
                         return false;
                     }
@@ -0,0 +1,117 @@
+#include "crc32c.h"
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+namespace {
+
+const uint32_t POLYNOMIAL = 0x82F63B78;  // Reversed 0x1EDC6F41
+
+using SliceTables = std::array<std::array<uint32_t, 256>, 8>;
+
+SliceTables BuildSliceTables() {
+    SliceTables tables;
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (size_t bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ POLYNOMIAL : crc >> 1;
+        }
+        tables[0][i] = crc;
+    }
+    for (size_t slice = 1; slice < tables.size(); ++slice) {
+        for (size_t i = 0; i < 256; ++i) {
+            tables[slice][i] = (tables[slice - 1][i] >> 8) ^ tables[0][tables[slice - 1][i] & 0xFF];
+        }
+    }
+    return tables;
+}
+
+const SliceTables &GetSliceTables() {
+    static const SliceTables tables = BuildSliceTables();
+    return tables;
+}
+
+// Product of two polynomials modulo the CRC polynomial, bit 31 is the coefficient of x^0
+uint32_t MultiplyModulo(uint32_t a, uint32_t b) {
+    uint32_t product = 0;
+    for (uint32_t mask = uint32_t{1} << 31; mask != 0; mask >>= 1) {
+        if (a & mask) {
+            product ^= b;
+        }
+        b = (b & 1) ? (b >> 1) ^ POLYNOMIAL : b >> 1;
+    }
+    return product;
+}
+
+// x^(8 * size) modulo the CRC polynomial
+uint32_t ShiftBytesModulo(size_t size) {
+    uint32_t power = uint32_t{1} << 30;  // x^1
+    for (size_t i = 0; i < 3; ++i) {
+        power = MultiplyModulo(power, power);
+    }
+    uint32_t result = uint32_t{1} << 31;  // x^0
+    for (; size != 0; size >>= 1) {
+        if (size & 1) {
+            result = MultiplyModulo(result, power);
+        }
+        power = MultiplyModulo(power, power);
+    }
+    return result;
+}
+
+uint32_t Crc32cSoftware(const char *data, size_t size, uint32_t crc) {
+    const SliceTables &tables = GetSliceTables();
+    const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+    crc = ~crc;
+    for (; size >= 8; size -= 8, bytes += 8) {
+        uint32_t low;
+        uint32_t high;
+        std::memcpy(&low, bytes, sizeof(low));
+        std::memcpy(&high, bytes + 4, sizeof(high));
+        if constexpr (std::endian::native == std::endian::big) {
+            low = __builtin_bswap32(low);
+            high = __builtin_bswap32(high);
+        }
+        low ^= crc;
+        crc = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF] ^ tables[5][(low >> 16) & 0xFF] ^
+              tables[4][low >> 24] ^ tables[3][high & 0xFF] ^ tables[2][(high >> 8) & 0xFF] ^
+              tables[1][(high >> 16) & 0xFF] ^ tables[0][high >> 24];
+    }
+    for (; size > 0; --size, ++bytes) {
+        crc = (crc >> 8) ^ tables[0][(crc ^ *bytes) & 0xFF];
+    }
+    return ~crc;
+}
+
+#if defined(__x86_64__)
+// The crc32 instruction of SSE4.2 computes the same CRC
+__attribute__((target("sse4.2"))) uint32_t Crc32cHardware(const char *data, size_t size, uint32_t crc) {
+    uint64_t value = ~crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        value = __builtin_ia32_crc32di(value, word);
+    }
+    for (; size > 0; --size, ++data) {
+        value = __builtin_ia32_crc32qi(static_cast<uint32_t>(value), static_cast<unsigned char>(*data));
+    }
+    return ~static_cast<uint32_t>(value);
+}
+#endif
+
+}  // namespace
+
+uint32_t Crc32c(const char *data, size_t size, uint32_t crc) {
+#if defined(__x86_64__)
+    static const bool has_hardware_crc = __builtin_cpu_supports("sse4.2");
+    if (has_hardware_crc) {
+        return Crc32cHardware(data, size, crc);
+    }
+#endif
+    return Crc32cSoftware(data, size, crc);
+}
+
+uint32_t Crc32cCombine(uint32_t crc_a, uint32_t crc_b, size_t size_b) {
+    return MultiplyModulo(ShiftBytesModulo(size_b), crc_a) ^ crc_b;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli), as used by iSCSI and ext4. Passing the checksum of the preceding data as crc
+// extends it, so Crc32c(b, Crc32c(a)) is the checksum of a followed by b.
+uint32_t Crc32c(const char *data, size_t size, uint32_t crc = 0);
+
+// Checksum of a followed by b from the checksums of both parts and the size of b
+uint32_t Crc32cCombine(uint32_t crc_a, uint32_t crc_b, size_t size_b);
@@ -0,0 +1,53 @@
+#include "histogram.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Consecutive bytes go to different tables, so increments of the same value don't wait for each other
+const size_t TABLES_COUNT = 8;
+const size_t MAX_CHUNK_SIZE = size_t{1} << 30;  // 32-bit counters can't overflow within a chunk
+
+using CountTables = std::array<std::array<uint32_t, 256>, TABLES_COUNT>;
+
+inline void CountWord(CountTables &tables, uint64_t word) {
+    ++tables[0][word & 0xFF];
+    ++tables[1][(word >> 8) & 0xFF];
+    ++tables[2][(word >> 16) & 0xFF];
+    ++tables[3][(word >> 24) & 0xFF];
+    ++tables[4][(word >> 32) & 0xFF];
+    ++tables[5][(word >> 40) & 0xFF];
+    ++tables[6][(word >> 48) & 0xFF];
+    ++tables[7][word >> 56];
+}
+
+void CountChunk(const unsigned char *data, size_t size, ByteHistogram &histogram) {
+    CountTables tables = {};
+    size_t i = 0;
+    for (; i + 2 * sizeof(uint64_t) <= size; i += 2 * sizeof(uint64_t)) {
+        uint64_t first;
+        uint64_t second;
+        std::memcpy(&first, data + i, sizeof(first));
+        std::memcpy(&second, data + i + sizeof(first), sizeof(second));
+        CountWord(tables, first);
+        CountWord(tables, second);
+    }
+    for (; i < size; ++i) {
+        ++tables[0][data[i]];
+    }
+    for (size_t value = 0; value < histogram.size(); ++value) {
+        for (const auto &table : tables) {
+            histogram[value] += table[value];
+        }
+    }
+}
+
+}  // namespace
+
+void CountBytes(const char *data, size_t size, ByteHistogram &histogram) {
+    const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+    for (size_t offset = 0; offset < size; offset += MAX_CHUNK_SIZE) {
+        CountChunk(bytes + offset, std::min(MAX_CHUNK_SIZE, size - offset), histogram);
+    }
+}
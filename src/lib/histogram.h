@@ -0,0 +1,11 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Number of occurrences of every byte value
+using ByteHistogram = std::array<uint64_t, 256>;
+
+// Adds the occurrences of the bytes of data to histogram
+void CountBytes(const char *data, size_t size, ByteHistogram &histogram);
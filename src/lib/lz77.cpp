@@ -0,0 +1,92 @@
+#include "lz77.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits.h>
+
+namespace {
+
+const size_t HASH_BITS = 16;
+const uint32_t NO_POSITION = UINT32_MAX;
+
+inline uint32_t HashAt(const char *data) {
+    uint32_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return (word * 2654435761u) >> (32 - HASH_BITS);
+}
+
+inline size_t MatchLength(const char *first, const char *second, size_t max_length) {
+    size_t length = 0;
+    while (length + sizeof(uint64_t) <= max_length) {
+        uint64_t first_word;
+        uint64_t second_word;
+        std::memcpy(&first_word, first + length, sizeof(first_word));
+        std::memcpy(&second_word, second + length, sizeof(second_word));
+        if (first_word != second_word) {
+            if constexpr (std::endian::native == std::endian::little) {
+                return length + std::countr_zero(first_word ^ second_word) / CHAR_BIT;
+            } else {
+                return length + std::countl_zero(first_word ^ second_word) / CHAR_BIT;
+            }
+        }
+        length += sizeof(uint64_t);
+    }
+    while (length < max_length && first[length] == second[length]) {
+        ++length;
+    }
+    return length;
+}
+
+}  // namespace
+
+std::vector<LzMatch> FindMatches(std::span<const char> data, size_t search_depth) {
+    std::vector<LzMatch> matches;
+    if (data.size() < lz77::MIN_MATCH || search_depth == 0) {
+        return matches;
+    }
+    std::vector<uint32_t> head(size_t{1} << HASH_BITS, NO_POSITION);
+    std::vector<uint32_t> previous(data.size());
+    const size_t last_hashed = data.size() - lz77::MIN_MATCH;
+    auto insert = [&](size_t position) {
+        uint32_t &chain = head[HashAt(data.data() + position)];
+        previous[position] = chain;
+        chain = static_cast<uint32_t>(position);
+    };
+
+    size_t position = 0;
+    while (position <= last_hashed) {
+        const size_t max_length = std::min(lz77::MAX_MATCH, data.size() - position);
+        size_t best_length = 0;
+        size_t best_distance = 0;
+        uint32_t candidate = head[HashAt(data.data() + position)];
+        for (size_t depth = 0; depth < search_depth && candidate != NO_POSITION; ++depth) {
+            // A longer match must also differ from the best one at its last byte
+            if (data[candidate + best_length] == data[position + best_length]) {
+                const size_t length = MatchLength(data.data() + candidate, data.data() + position, max_length);
+                if (length > best_length) {
+                    best_length = length;
+                    best_distance = position - candidate;
+                    if (length == max_length) {
+                        break;
+                    }
+                }
+            }
+            candidate = previous[candidate];
+        }
+
+        insert(position);
+        if (best_length < lz77::MIN_MATCH) {
+            ++position;
+            continue;
+        }
+        matches.push_back({.position = static_cast<uint32_t>(position),
+                           .length = static_cast<uint32_t>(best_length),
+                           .distance = static_cast<uint32_t>(best_distance)});
+        const size_t end = position + best_length;
+        for (++position; position < end && position <= last_hashed; ++position) {
+            insert(position);
+        }
+        position = end;
+    }
+    return matches;
+}
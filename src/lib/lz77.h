@@ -0,0 +1,59 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Back reference to length bytes that start distance bytes before position
+struct LzMatch {
+    uint32_t position = 0;
+    uint32_t length = 0;
+    uint32_t distance = 0;
+};
+
+namespace lz77 {
+
+inline const size_t MIN_MATCH = 4;
+inline const size_t MAX_MATCH = MIN_MATCH + (1 << 16) - 1;
+
+// Numbers of codes of MAX_MATCH - MIN_MATCH and of distances up to 2^30
+inline const size_t LENGTH_CODES_COUNT = 32;
+inline const size_t DISTANCE_CODES_COUNT = 60;
+
+// Values are coded as a code with one bit of mantissa and the rest of the bits as they are: 0..3 are
+// codes themselves, and a value with the highest bit h >= 2 gets code 2h or 2h + 1 with h - 1 extra bits
+struct ValueCode {
+    uint32_t code = 0;
+    uint32_t extra_bits_count = 0;
+    uint32_t extra_bits = 0;
+};
+
+inline ValueCode SplitValue(uint32_t value) {
+    if (value < 4) {
+        return {.code = value};
+    }
+    const uint32_t high_bit = static_cast<uint32_t>(std::bit_width(value)) - 1;
+    return {.code = 2 * high_bit + ((value >> (high_bit - 1)) & 1),
+            .extra_bits_count = high_bit - 1,
+            .extra_bits = value & ((1u << (high_bit - 1)) - 1)};
+}
+
+inline uint32_t ExtraBitsCount(uint32_t code) {
+    return code < 4 ? 0 : code / 2 - 1;
+}
+
+inline uint32_t JoinValue(uint32_t code, uint32_t extra_bits) {
+    if (code < 4) {
+        return code;
+    }
+    return ((2 | (code & 1)) << ExtraBitsCount(code)) | extra_bits;
+}
+
+};  // namespace lz77
+
+// Greedy LZ77 parse with hash chains: every position looks at up to search_depth earlier positions
+// that start with the same MIN_MATCH bytes, nearest first, and takes the longest match. Matches don't
+// reach outside data, which must be shorter than 2^30 bytes
+std::vector<LzMatch> FindMatches(std::span<const char> data, size_t search_depth);
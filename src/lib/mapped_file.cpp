@@ -0,0 +1,52 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &file_name) : is_mapped_(false), data_(nullptr), size_(0) {
+    // Opening a named pipe would take its data from the writer, so only regular files are opened
+    struct stat status;
+    if (stat(file_name.c_str(), &status) != 0 || !S_ISREG(status.st_mode)) {
+        return;
+    }
+    const int descriptor = open(file_name.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return;
+    }
+    if (fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode)) {
+        size_ = static_cast<size_t>(status.st_size);
+        if (size_ == 0) {
+            is_mapped_ = true;  // Nothing to map
+        } else {
+            data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            is_mapped_ = data_ != MAP_FAILED;
+            if (is_mapped_) {
+                madvise(data_, size_, MADV_SEQUENTIAL);
+            } else {
+                data_ = nullptr;
+                size_ = 0;
+            }
+        }
+    }
+    close(descriptor);  // The mapping stays valid
+}
+
+bool MappedFile::IsMapped() const {
+    return is_mapped_;
+}
+
+const char *MappedFile::GetData() const {
+    return static_cast<const char *>(data_);
+}
+
+size_t MappedFile::GetSize() const {
+    return size_;
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole regular file, hinted for sequential reading. Pipes, devices and
+// files that can't be mapped stay unmapped and have to be read with Reader instead
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &file_name);
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool IsMapped() const;
+
+    const char *GetData() const;
+
+    size_t GetSize() const;
+
+    ~MappedFile();
+
+private:
+    bool is_mapped_;
+    void *data_;
+    size_t size_;
+};
@@ -0,0 +1,33 @@
+#include "positional_writer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+PositionalWriter::PositionalWriter(const std::string &file_name)
+    : descriptor_(open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) {
+    if (descriptor_ < 0) {
+        throw FileWriteError();
+    }
+}
+
+void PositionalWriter::Write(const char *data, size_t size, size_t offset) {
+    while (size > 0) {
+        const ssize_t written = pwrite(descriptor_, data, size, static_cast<off_t>(offset));
+        if (written <= 0) {
+            throw FileWriteError();
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<size_t>(written);
+    }
+}
+
+void PositionalWriter::Clear() {
+    if (ftruncate(descriptor_, 0) != 0) {
+        throw FileWriteError();
+    }
+}
+
+PositionalWriter::~PositionalWriter() {
+    close(descriptor_);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <exception>
+#include <string>
+
+// Output file that accepts writes at arbitrary offsets from several threads at once
+class PositionalWriter {
+public:
+    class FileWriteError : public std::exception {};
+
+    explicit PositionalWriter(const std::string &file_name);
+
+    PositionalWriter(const PositionalWriter &) = delete;
+    PositionalWriter &operator=(const PositionalWriter &) = delete;
+
+    void Write(const char *data, size_t size, size_t offset);
+
+    void Clear();
+
+    ~PositionalWriter();
+
+private:
+    int descriptor_;
+};
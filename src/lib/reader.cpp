@@ -1,54 +1,282 @@
 #include "reader.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+uint64_t LoadBigEndian(const char *data) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    static_assert(std::endian::native == std::endian::little || std::endian::native == std::endian::big);
+    if constexpr (std::endian::native == std::endian::little) {
+        word = __builtin_bswap64(word);
+    }
+    return word;
+}
+
+}  // namespace
 
 Reader::Reader(const std::string &file_name, size_t buffer_byte_size)
-    : file_name_(file_name), stream_(file_name), data_(), next_position_(0), buffer_size_(buffer_byte_size * CHAR_BIT) {
-    data_.reserve(buffer_size_);
+    : file_name_(file_name),
+      file_stream_(),
+      stream_(file_name == STANDARD_INPUT_NAME ? static_cast<std::istream *>(&std::cin) : &file_stream_),
+      is_memory_(false),
+      is_seekable_(false),
+      memory_(),
+      buffer_(std::make_unique_for_overwrite<char[]>(std::max<size_t>(buffer_byte_size, sizeof(uint64_t)))),
+      data_(buffer_.get()),
+      data_size_(0),
+      buffer_offset_(0),
+      next_byte_(0),
+      bit_buffer_(0),
+      bits_available_(0),
+      buffer_size_(std::max<size_t>(buffer_byte_size, sizeof(uint64_t)) * CHAR_BIT),
+      is_input_end_(false),
+      spare_(),
+      spare_size_(0),
+      is_spare_end_(false),
+      is_spare_requested_(false),
+      is_prefetching_(false),
+      is_stopped_(false) {
+    if (stream_ == &file_stream_) {
+        std::error_code error;
+        is_seekable_ = std::filesystem::is_regular_file(file_name, error);
+        file_stream_.open(file_name);
+    }
     UpdateBuffer();
 }
 
+Reader::Reader(std::vector<char> data)
+    : file_name_(),
+      file_stream_(),
+      stream_(nullptr),
+      is_memory_(true),
+      is_seekable_(true),
+      memory_(std::move(data)),
+      buffer_(),
+      data_(memory_.data()),
+      data_size_(memory_.size()),
+      buffer_offset_(0),
+      next_byte_(0),
+      bit_buffer_(0),
+      bits_available_(0),
+      buffer_size_(memory_.size() * CHAR_BIT),
+      is_input_end_(false),
+      spare_(),
+      spare_size_(0),
+      is_spare_end_(false),
+      is_spare_requested_(false),
+      is_prefetching_(false),
+      is_stopped_(false) {
+}
+
 bool Reader::ReadBit() {
-    if (next_position_ >= data_.size()) {
-        if (!UpdateBuffer()) {
+    return ReadBits<bool>(1);
+}
+
+void Reader::Reload() {
+    Seek(0);
+}
+
+size_t Reader::Tell() const {
+    return buffer_offset_ + next_byte_ - bits_available_ / CHAR_BIT;
+}
+
+void Reader::Seek(size_t byte_offset) {
+    if (!IsSeekable()) {
+        if (byte_offset < Tell()) {
             throw FileReadError();
         }
+        SkipBytes(byte_offset - Tell());
+        return;
     }
-    return data_[next_position_++];
+    bit_buffer_ = 0;
+    bits_available_ = 0;
+    if (is_memory_) {
+        next_byte_ = std::min(byte_offset, data_size_);
+        return;
+    }
+    if (is_spare_requested_) {
+        WaitForInput();  // A read in flight can't be cancelled
+        is_spare_requested_ = false;
+    }
+    is_input_end_ = false;
+    stream_->clear();
+    stream_->seekg(static_cast<std::streamoff>(byte_offset));
+    buffer_offset_ = byte_offset;
+    data_size_ = 0;
+    next_byte_ = 0;
+    UpdateBuffer();
 }
 
-void Reader::Reload() {
-    stream_.clear();
-    stream_.seekg(0);
-    data_.clear();
-    next_position_ = 0;
-    UpdateBuffer();
+bool Reader::IsSeekable() const {
+    return is_seekable_;
+}
+
+size_t Reader::GetSize() const {
+    if (is_memory_) {
+        return data_size_;
+    }
+    if (!IsSeekable()) {
+        throw FileReadError();
+    }
+    std::error_code error;
+    const size_t size = std::filesystem::file_size(file_name_, error);
+    if (error) {
+        throw FileReadError();
+    }
+    return size;
 }
 
 bool Reader::IsEof() const {
-    return next_position_ >= data_.size() && stream_.eof();
+    return bits_available_ == 0 && next_byte_ >= data_size_ && (is_memory_ || is_input_end_);
 }
 
 std::string Reader::GetFileName() const {
     return file_name_;
 }
 
+Reader::~Reader() {
+    if (input_thread_.joinable()) {
+        {
+            std::lock_guard lock(mutex_);
+            is_stopped_ = true;
+        }
+        state_changed_.notify_all();
+        input_thread_.join();
+    }
+}
+
+size_t Reader::ReadBytes(char *data, size_t size) {
+    size_t read = 0;
+    while (read < size && bits_available_ >= CHAR_BIT) {
+        data[read++] = ReadBits<char>(CHAR_BIT);
+    }
+    if (bits_available_ == 0) {
+        bit_buffer_ = 0;  // Drop bits of the bytes that are copied below
+    }
+    while (read < size) {
+        if (next_byte_ >= data_size_ && !UpdateBuffer()) {
+            break;
+        }
+        const size_t chunk_size = std::min(size - read, data_size_ - next_byte_);
+        std::memcpy(data + read, data_ + next_byte_, chunk_size);
+        next_byte_ += chunk_size;
+        read += chunk_size;
+    }
+    return read;
+}
+
+size_t Reader::SkipBytes(size_t size) {
+    size_t skipped = 0;
+    while (skipped < size && bits_available_ >= CHAR_BIT) {
+        SkipBits(CHAR_BIT);
+        ++skipped;
+    }
+    if (bits_available_ == 0) {
+        bit_buffer_ = 0;
+    }
+    while (skipped < size) {
+        if (next_byte_ >= data_size_ && !UpdateBuffer()) {
+            break;
+        }
+        const size_t chunk_size = std::min(size - skipped, data_size_ - next_byte_);
+        next_byte_ += chunk_size;
+        skipped += chunk_size;
+    }
+    return skipped;
+}
+
+void Reader::AlignToByte() {
+    SkipBits(bits_available_ % CHAR_BIT);
+}
+
 bool Reader::UpdateBuffer() {
-    std::string char_data(buffer_size_ / CHAR_BIT, 0);
-    stream_.read(char_data.data(), static_cast<std::streamsize>(char_data.size()));
-
-    std::streamsize new_size = stream_.gcount();
-    data_.resize(new_size * CHAR_BIT);
-    next_position_ = 0;
-    for (size_t i = 0; i < new_size; ++i) {
-        static_assert(std::endian::native == std::endian::little || std::endian::native == std::endian::big);
-        if constexpr (std::endian::native == std::endian::big) {
-            for (size_t j = 0; j < CHAR_BIT; ++j) {
-                data_[i * CHAR_BIT + j] = (char_data[i] >> j) & 1;
-            }
-        } else {
-            for (size_t j = 0; j < CHAR_BIT; ++j) {
-                data_[i * CHAR_BIT + j] = (char_data[i] >> (CHAR_BIT - 1 - j)) & 1;
-            }
+    if (is_memory_) {
+        return false;
+    }
+    Stats::PhaseTimer timer(Stats::Phase::ReadWait);
+    Stats::Add(Stats::Counter::ReaderRefills, 1);
+    buffer_offset_ += data_size_;
+    next_byte_ = 0;
+    if (is_spare_requested_) {
+        WaitForInput();
+        std::swap(buffer_, spare_);
+        data_ = buffer_.get();
+        data_size_ = spare_size_;
+        is_input_end_ = is_spare_end_;
+        is_spare_requested_ = false;
+    } else if (is_input_end_) {
+        data_size_ = 0;
+    } else {
+        data_size_ = ReadInput(buffer_.get(), is_input_end_);
+    }
+    if (!is_input_end_) {
+        RequestSpare();
+    }
+    return data_size_ > 0;
+}
+
+size_t Reader::ReadInput(char *data, bool &is_end) {
+    stream_->read(data, static_cast<std::streamsize>(buffer_size_ / CHAR_BIT));
+    const size_t size = static_cast<size_t>(stream_->gcount());
+    // Also finds the end if the input size is a multiple of the buffer size
+    is_end = stream_->peek() == std::istream::traits_type::eof();
+    return size;
+}
+
+void Reader::RequestSpare() {
+    if (!input_thread_.joinable()) {
+        spare_ = std::make_unique_for_overwrite<char[]>(buffer_size_ / CHAR_BIT);
+        input_thread_ = std::thread([this]() { ReadSpares(); });
+    }
+    {
+        std::lock_guard lock(mutex_);
+        is_prefetching_ = true;
+    }
+    is_spare_requested_ = true;
+    state_changed_.notify_all();
+}
+
+void Reader::WaitForInput() {
+    std::unique_lock lock(mutex_);
+    state_changed_.wait(lock, [this]() { return !is_prefetching_; });
+}
+
+void Reader::ReadSpares() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        state_changed_.wait(lock, [this]() { return is_prefetching_ || is_stopped_; });
+        if (!is_prefetching_) {
+            return;
+        }
+        lock.unlock();
+        spare_size_ = ReadInput(spare_.get(), is_spare_end_);
+        lock.lock();
+        is_prefetching_ = false;
+        state_changed_.notify_all();
+    }
+}
+
+void Reader::Refill() {
+    if (data_size_ - next_byte_ >= sizeof(uint64_t)) {
+        // Whole-word refill: bits past bits_available_ are re-read with the same values next time
+        bit_buffer_ |= LoadBigEndian(data_ + next_byte_) >> bits_available_;
+        const size_t bytes = (64 - bits_available_) / CHAR_BIT;
+        next_byte_ += bytes;
+        bits_available_ += bytes * CHAR_BIT;
+        return;
+    }
+    while (bits_available_ <= 56) {
+        if (next_byte_ >= data_size_ && !UpdateBuffer()) {
+            break;
         }
+        bit_buffer_ |= static_cast<uint64_t>(static_cast<unsigned char>(data_[next_byte_++]))
+                       << (56 - bits_available_);
+        bits_available_ += CHAR_BIT;
     }
-    return !data_.empty();
 }
@@ -1,46 +1,156 @@
 #pragma once
 
 #include <bit>
+#include <condition_variable>
+#include <cstdint>
 #include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <string>
 #include <limits.h>
 
+// Files and the standard input are read ahead: once a buffer is taken, a background thread reads the next
+// one into a spare buffer, so the caller waits for the input only if it is slower. Bits are taken from the
+// current buffer without locks. Inputs that fit into one buffer are read without a thread
 class Reader {
-    const static size_t DEFAULT_BUFFER_SIZE = 32768;
-
 public:
+    inline const static size_t DEFAULT_FILE_BUFFER_BYTE_SIZE = 1 << 20;
+
     class FileReadError : std::exception {};
 
-    explicit Reader(const std::string &file_name, size_t buffer_byte_size = (DEFAULT_BUFFER_SIZE / CHAR_BIT));
+    // Maximum number of bits that a single accumulator read can return
+    static constexpr size_t MAX_READ_BITS = 57;
+
+    // File name that stands for the standard input
+    inline const static std::string STANDARD_INPUT_NAME = "-";
+
+    explicit Reader(const std::string &file_name, size_t buffer_byte_size = DEFAULT_FILE_BUFFER_BYTE_SIZE);
+
+    // Reads from the given bytes instead of a file
+    explicit Reader(std::vector<char> data);
+
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
 
     bool ReadBit();
 
     template <typename T>
     T ReadBits(size_t number_bits);
 
+    // Returns the next bits without consuming them, zero-padded past the end of file
+    template <typename T>
+    T PeekBits(size_t number_bits);
+
+    void SkipBits(size_t number_bits);
+
+    // Reads up to size bytes, must be called on a byte boundary. Returns the number of bytes read
+    size_t ReadBytes(char *data, size_t size);
+
+    // Skips the rest of the current byte
+    void AlignToByte();
+
+    // Byte offset of the next unread bit, must be called on a byte boundary
+    size_t Tell() const;
+
+    // Continues reading from the given byte offset. Inputs that are not seekable can only skip forward
+    void Seek(size_t byte_offset);
+
+    // Only regular files and bytes in memory are seekable, pipes and devices are not
+    bool IsSeekable() const;
+
+    // Size of the whole input in bytes, only for seekable inputs
+    size_t GetSize() const;
+
     void Reload();
 
     bool IsEof() const;
 
     std::string GetFileName() const;
 
+    ~Reader();
+
 private:
     std::string file_name_;
-    std::ifstream stream_;
-    std::vector<bool> data_;
-    size_t next_position_;
-    const size_t buffer_size_ = DEFAULT_BUFFER_SIZE;
+    std::ifstream file_stream_;
+    std::istream *stream_;
+    bool is_memory_;
+    bool is_seekable_;
+    std::vector<char> memory_;      // Bytes of a reader in memory
+    std::unique_ptr<char[]> buffer_;  // Not initialized, so that pages of large buffers are touched only when used
+    const char *data_;              // Bytes being read, in buffer_ or memory_
+    size_t data_size_;
+    size_t buffer_offset_;  // Input offset of the first byte of data_
+    size_t next_byte_;
+    uint64_t bit_buffer_;  // Next unread bit is the most significant one
+    size_t bits_available_;
+    const size_t buffer_size_ = DEFAULT_FILE_BUFFER_BYTE_SIZE * CHAR_BIT;
+    bool is_input_end_;  // Nothing follows data_ in the input
+
+    std::unique_ptr<char[]> spare_;  // Buffer that the input thread reads the data after data_ into
+    size_t spare_size_;
+    bool is_spare_end_;
+    bool is_spare_requested_;  // spare_ is being read or holds the data after data_, only the caller uses it
+    bool is_prefetching_;
+    bool is_stopped_;
+    std::mutex mutex_;
+    std::condition_variable state_changed_;
+    std::thread input_thread_;  // Started by the first input that doesn't fit into one buffer
 
     bool UpdateBuffer();
+
+    // Same as ReadBytes without copying the bytes anywhere
+    size_t SkipBytes(size_t size);
+
+    void Refill();
+
+    // Reads up to a buffer from the input, is_end tells if nothing follows
+    size_t ReadInput(char *data, bool &is_end);
+
+    // Makes the input thread read the data after data_ into the spare buffer
+    void RequestSpare();
+
+    void WaitForInput();
+
+    void ReadSpares();
 };
 
 template <typename T>
 T Reader::ReadBits(size_t number_bits) {
-    T result = 0;
-    for (size_t i = 0; i < number_bits; ++i) {
-        result <<= 1;
-        result |= static_cast<T>(ReadBit());
+    if (number_bits == 0) {
+        return 0;
+    }
+    if (number_bits > MAX_READ_BITS) {
+        const size_t low_bits = number_bits - MAX_READ_BITS;
+        const uint64_t high = ReadBits<uint64_t>(MAX_READ_BITS);
+        return static_cast<T>((high << low_bits) | ReadBits<uint64_t>(low_bits));
+    }
+    if (bits_available_ < number_bits) {
+        Refill();
+        if (bits_available_ < number_bits) {
+            throw FileReadError();
+        }
+    }
+    const uint64_t result = bit_buffer_ >> (64 - number_bits);
+    bit_buffer_ <<= number_bits;
+    bits_available_ -= number_bits;
+    return static_cast<T>(result);
+}
+
+template <typename T>
+T Reader::PeekBits(size_t number_bits) {
+    if (bits_available_ < number_bits) {
+        Refill();
+    }
+    return static_cast<T>(bit_buffer_ >> (64 - number_bits));
+}
+
+inline void Reader::SkipBits(size_t number_bits) {
+    if (bits_available_ < number_bits) {
+        throw FileReadError();
     }
-    return result;
-}
\ No newline at end of file
+    bit_buffer_ <<= number_bits;
+    bits_available_ -= number_bits;
+}
@@ -0,0 +1,94 @@
+#include "stats.h"
+
+#include <iomanip>
+#include <limits.h>
+
+namespace {
+
+const std::array<const char *, static_cast<size_t>(Stats::Counter::Count)> COUNTER_KEYS = {
+    "raw_bytes", "archive_bytes", "symbols", "blocks", "tables", "reader_refills", "writer_flushes"};
+const std::array<const char *, static_cast<size_t>(Stats::Counter::Count)> COUNTER_NAMES = {
+    "raw", "archive", "symbols", "blocks", "tables", "refills", "flushes"};
+const std::array<const char *, static_cast<size_t>(Stats::Phase::Count)> PHASE_KEYS = {
+    "counting_ns", "matching_ns", "table_build_ns", "coding_ns", "read_wait_ns", "write_wait_ns"};
+const std::array<const char *, static_cast<size_t>(Stats::Phase::Count)> PHASE_NAMES = {
+    "counting", "matching", "table build", "coding", "read wait", "write wait"};
+
+// Archive bits are reported in bytes
+uint64_t GetReported(const Stats::Record &record, size_t counter) {
+    const uint64_t value = record.Get(static_cast<Stats::Counter>(counter));
+    return static_cast<Stats::Counter>(counter) == Stats::Counter::ArchiveBits ? (value + CHAR_BIT - 1) / CHAR_BIT
+                                                                             : value;
+}
+
+void PrintMilliseconds(std::ostream &output, uint64_t nanoseconds) {
+    output << std::fixed << std::setprecision(3) << static_cast<double>(nanoseconds) / 1e6 << " ms";
+}
+
+void PrintRecordText(std::ostream &output, const Stats::Record &record) {
+    output << record.name << "\n  ";
+    for (size_t i = 0; i < COUNTER_NAMES.size(); ++i) {
+        output << (i == 0 ? "" : ", ") << COUNTER_NAMES[i] << ' ' << GetReported(record, i);
+    }
+    output << "\n  ";
+    for (size_t i = 0; i < PHASE_NAMES.size(); ++i) {
+        output << (i == 0 ? "" : ", ") << PHASE_NAMES[i] << ' ';
+        PrintMilliseconds(output, record.GetNanoseconds(static_cast<Stats::Phase>(i)));
+    }
+    output << '\n';
+}
+
+void PrintJsonString(std::ostream &output, const std::string &value) {
+    output << '"';
+    for (unsigned char ch : value) {
+        if (ch == '"' || ch == '\\') {
+            output << '\\' << ch;
+        } else if (ch < 0x20) {
+            output << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(ch) << std::dec
+                   << std::setfill(' ');
+        } else {
+            output << ch;
+        }
+    }
+    output << '"';
+}
+
+void PrintRecordJson(std::ostream &output, const Stats::Record &record) {
+    output << "{\"name\": ";
+    PrintJsonString(output, record.name);
+    for (size_t i = 0; i < COUNTER_KEYS.size(); ++i) {
+        output << ", \"" << COUNTER_KEYS[i] << "\": " << GetReported(record, i);
+    }
+    for (size_t i = 0; i < PHASE_KEYS.size(); ++i) {
+        output << ", \"" << PHASE_KEYS[i] << "\": " << record.GetNanoseconds(static_cast<Stats::Phase>(i));
+    }
+    output << '}';
+}
+
+}  // namespace
+
+Stats::Record &Stats::AddFile(const std::string &name) {
+    std::lock_guard lock(files_mutex_);
+    return files_.emplace_back(name);
+}
+
+void Stats::PrintText(std::ostream &output, std::chrono::nanoseconds wall_time) const {
+    for (const Record &file : files_) {
+        PrintRecordText(output, file);
+    }
+    PrintRecordText(output, total_);
+    output << "wall ";
+    PrintMilliseconds(output, static_cast<uint64_t>(wall_time.count()));
+    output << std::endl;
+}
+
+void Stats::PrintJson(std::ostream &output, std::chrono::nanoseconds wall_time) const {
+    output << "{\"files\": [";
+    for (size_t i = 0; i < files_.size(); ++i) {
+        output << (i == 0 ? "" : ", ");
+        PrintRecordJson(output, files_[i]);
+    }
+    output << "], \"total\": ";
+    PrintRecordJson(output, total_);
+    output << ", \"wall_ns\": " << wall_time.count() << '}' << std::endl;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+// Counters and phase timers of a run for --stats. Events count for the record of the file that the
+// current thread works on, if any, and for the total. Threads that work on nothing for a Stats pay a
+// thread-local check per event, and building with ARCHIVER_NO_STATS removes even that. Events are
+// per buffer, table or block, never per symbol. Phases can contain each other, e.g. coding that
+// flushes a full buffer includes the write wait
+class Stats {
+public:
+#ifdef ARCHIVER_NO_STATS
+    static constexpr bool IS_COMPILED = false;
+#else
+    static constexpr bool IS_COMPILED = true;
+#endif
+
+    enum class Counter {
+        RawBytes,       // Data before compression or after decompression
+        ArchiveBits,    // Archive data written, or blocks read when decompressing a block archive
+        Symbols,        // Codes written or read, match references count as one
+        Blocks,
+        Tables,         // Code tables built
+        ReaderRefills,  // Buffers read from a file or a pipe
+        WriterFlushes,  // Buffers passed to a file, a pipe or memory
+        Count,
+    };
+
+    enum class Phase {
+        Counting,  // Counting occurrences of symbols
+        Matching,  // Finding LZ77 matches
+        TableBuild,
+        Coding,
+        ReadWait,
+        WriteWait,
+        Count,
+    };
+
+    struct Record {
+        explicit Record(std::string name) : name(std::move(name)) {
+        }
+
+        uint64_t Get(Counter counter) const {
+            return counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+        }
+
+        uint64_t GetNanoseconds(Phase phase) const {
+            return nanoseconds[static_cast<size_t>(phase)].load(std::memory_order_relaxed);
+        }
+
+        std::string name;
+        std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::Count)> counters = {};
+        std::array<std::atomic<uint64_t>, static_cast<size_t>(Phase::Count)> nanoseconds = {};
+    };
+
+private:
+    // The same counter or timer in the total and in the file record
+    struct Slots {
+        std::atomic<uint64_t> *total;
+        std::atomic<uint64_t> *file;
+    };
+
+    // Records that the events of a thread count for, none while both are null
+    struct Current {
+        Record *total;
+        Record *file;
+    };
+
+public:
+
+    // Makes events on this thread count for stats and file until it is destroyed. Does nothing if stats
+    // is null
+    class Scope {
+    public:
+        explicit Scope(Stats *stats, Record *file = nullptr) : previous_(current_) {
+            if (stats != nullptr) {
+                current_ = {.total = &stats->total_, .file = file};
+            }
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        ~Scope() {
+            current_ = previous_;
+        }
+
+    private:
+        Current previous_;
+    };
+
+    // Adds the time until it is destroyed to the phase
+    class PhaseTimer {
+    public:
+        explicit PhaseTimer(Phase phase) : phase_(phase) {
+            if (IS_COMPILED && current_.total != nullptr) {
+                start_ = std::chrono::steady_clock::now();
+            }
+        }
+
+        PhaseTimer(const PhaseTimer &) = delete;
+        PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+        ~PhaseTimer() {
+            if (IS_COMPILED && current_.total != nullptr) {
+                const auto elapsed = std::chrono::steady_clock::now() - start_;
+                AddTo(SlotsOf(phase_),
+                      static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+            }
+        }
+
+    private:
+        Phase phase_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    Stats() : total_("total") {
+    }
+
+    static void Add(Counter counter, uint64_t value) {
+        if (IS_COMPILED && current_.total != nullptr) {
+            AddTo(SlotsOf(counter), value);
+        }
+    }
+
+    // The record stays in place for the lifetime of the stats
+    Record &AddFile(const std::string &name);
+
+    const Record &GetTotal() const {
+        return total_;
+    }
+
+    // Wall time of the whole run is reported along with the records
+    void PrintText(std::ostream &output, std::chrono::nanoseconds wall_time) const;
+
+    void PrintJson(std::ostream &output, std::chrono::nanoseconds wall_time) const;
+
+private:
+    inline static thread_local Current current_;
+
+    Record total_;
+    std::deque<Record> files_;
+    std::mutex files_mutex_;
+
+    static Slots SlotsOf(Counter counter) {
+        const size_t index = static_cast<size_t>(counter);
+        return {&current_.total->counters[index], current_.file != nullptr ? &current_.file->counters[index] : nullptr};
+    }
+
+    static Slots SlotsOf(Phase phase) {
+        const size_t index = static_cast<size_t>(phase);
+        return {&current_.total->nanoseconds[index],
+                current_.file != nullptr ? &current_.file->nanoseconds[index] : nullptr};
+    }
+
+    static void AddTo(Slots slots, uint64_t value) {
+        slots.total->fetch_add(value, std::memory_order_relaxed);
+        if (slots.file != nullptr) {
+            slots.file->fetch_add(value, std::memory_order_relaxed);
+        }
+    }
+};
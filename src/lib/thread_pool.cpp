@@ -0,0 +1,39 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(size_t threads_count) : threads_(), tasks_(), mutex_(), has_task_(), is_stopped_(false) {
+    threads_.reserve(threads_count);
+    for (size_t i = 0; i < threads_count; ++i) {
+        threads_.emplace_back(&ThreadPool::Work, this);
+    }
+}
+
+size_t ThreadPool::GetThreadsCount() const {
+    return threads_.size();
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex_);
+        is_stopped_ = true;
+    }
+    has_task_.notify_all();
+    for (auto &thread : threads_) {
+        thread.join();
+    }
+}
+
+void ThreadPool::Work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex_);
+            has_task_.wait(lock, [this]() { return is_stopped_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+        task();
+    }
+}
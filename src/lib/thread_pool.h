@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    // Without threads every task runs inside Submit
+    explicit ThreadPool(size_t threads_count);
+
+    template <typename Function>
+    std::future<std::invoke_result_t<Function>> Submit(Function function);
+
+    size_t GetThreadsCount() const;
+
+    ~ThreadPool();
+
+private:
+    std::vector<std::thread> threads_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable has_task_;
+    bool is_stopped_;
+
+    void Work();
+};
+
+template <typename Function>
+std::future<std::invoke_result_t<Function>> ThreadPool::Submit(Function function) {
+    using Result = std::invoke_result_t<Function>;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+    std::future<Result> result = task->get_future();
+    if (threads_.empty()) {
+        (*task)();
+        return result;
+    }
+    {
+        std::lock_guard lock(mutex_);
+        tasks_.emplace([task]() { (*task)(); });
+    }
+    has_task_.notify_one();
+    return result;
+}
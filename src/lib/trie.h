@@ -1,113 +1,78 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <exception>
+#include <limits>
 #include <memory>
+#include <utility>
 #include <vector>
 
-template <typename T, size_t ALPHABET_SIZE>
+// Nodes live contiguously in an arena and refer to their children by offset, so inserting a path
+// allocates only when the arena grows and a trie is freed at once. All walks are loops, so paths of any
+// length are safe. Allocator is the allocator template used for the arena
+template <typename T, size_t ALPHABET_SIZE, template <typename> class Allocator = std::allocator>
 class Trie {
     using VertexPath = std::pair<std::vector<size_t>, T>;
-
-    class TrieNode {
-    public:
-        using PtrArray = std::array<std::unique_ptr<TrieNode>, ALPHABET_SIZE>;
-
-        explicit TrieNode() : value_(), is_terminal_(false), children_() {
-        }
-
-        void SetValue(T value) {
-            value_ = value;
-        }
-
-        void SetState(bool is_terminal) {
-            is_terminal_ = is_terminal;
-        }
-
-        void SetChildren(size_t index, std::unique_ptr<TrieNode> &child) {
-            std::swap(children_[index], child);
-        }
-
-        template <typename Iterator>
-        std::pair<const T *, Iterator> Traverse(Iterator it, Iterator end) const {
-            if (is_terminal_) {
-                return {&value_, it};
-            }
-            if (it == end || !children_[*it]) {
-                return {nullptr, it};
-            }
-            return children_[*it]->Traverse(next(it), end);
-        }
-
-        const T *Traverse(const auto &get_next) const {
-            if (is_terminal_) {
-                return &value_;
-            }
-            size_t edge = get_next();
-            if (!children_[edge]) {
-                return nullptr;
-            }
-            return children_[edge]->Traverse(get_next);
-        }
-
-        template <typename Iterator>
-        bool InsertPath(Iterator begin, Iterator end, T &value) {
-            if (begin == end) {
-                SetValue(value);
-                if (is_terminal_) {
-                    return false;
-                }
-                SetState(true);
-                return true;
-            }
-            if (!children_[*begin]) {
-                children_[*begin] = std::make_unique<TrieNode>();
-            }
-            return children_[*begin]->InsertPath(std::next(begin), end, value);
-        }
-
-        std::vector<VertexPath> GetTerminals() const {
-            std::vector<VertexPath> result;
-            std::vector<size_t> path;
-            SearchTerminals(path, result);
-            return result;
-        }
-
-    private:
-        T value_;
-        bool is_terminal_;
-
-        PtrArray children_;
-
-        void SearchTerminals(std::vector<size_t> &path, std::vector<VertexPath> &terminals) const {
-            if (is_terminal_) {
-                terminals.emplace_back(path, value_);
-            }
-            for (size_t edge = 0; edge < ALPHABET_SIZE; ++edge) {
-                if (!children_[edge]) {
-                    continue;
-                }
-                path.push_back(edge);
-                children_[edge]->SearchTerminals(path, terminals);
-                path.pop_back();
-            }
-        }
+    using Index = uint32_t;
+    // Offset of a node in bytes from the start of the arena. Following it needs no multiplication by the
+    // node size, which is on the critical path of a walk
+    using Link = uint32_t;
+
+    // The root is never a child, so its link marks a missing child
+    const static Link NO_CHILD = 0;
+    const static Index ROOT = 0;
+
+    struct TrieNode {
+        T value = {};
+        bool is_terminal = false;
+        std::array<Link, ALPHABET_SIZE> children = {};
     };
 
 public:
-    explicit Trie() : root_(std::make_unique<TrieNode>()), number_terminals_(0) {
+    // Largest number of nodes that the links can reach
+    static constexpr size_t MAX_NODES = std::numeric_limits<Link>::max() / sizeof(TrieNode) + 1;
+
+    // Inserting or merging would take more than MAX_NODES nodes
+    class TooManyNodesException : public std::exception {};
+
+    explicit Trie() : nodes_(1), number_terminals_(0) {
     }
 
+    // Throws TooManyNodesException if the path needs a node past MAX_NODES
     template <typename Sequence>
     void Insert(const Sequence &path, T value = {}) {
-        if (root_->InsertPath(std::begin(path), std::end(path), value)) {
+        Index node = ROOT;
+        for (const auto &edge : path) {
+            if (nodes_[node].children[edge] == NO_CHILD) {
+                if (nodes_.size() >= MAX_NODES) {
+                    throw TooManyNodesException();
+                }
+                nodes_[node].children[edge] = LinkTo(static_cast<Index>(nodes_.size()));
+                nodes_.emplace_back();
+            }
+            node = IndexOf(nodes_[node].children[edge]);
+        }
+        nodes_[node].value = value;
+        if (!nodes_[node].is_terminal) {
+            nodes_[node].is_terminal = true;
             ++number_terminals_;
         }
     }
 
+    // The tries become the subtries of the edges 0, 1, ... of the result and are left empty. Their
+    // arenas are appended to the result with shifted indices. Throws TooManyNodesException and leaves the
+    // tries unchanged if the result would not fit
     template <typename... Args>
     static Trie Merge(Args &...args) {
+        const size_t nodes_count = 1 + (args.nodes_.size() + ... + 0);
+        if (nodes_count > MAX_NODES) {
+            throw TooManyNodesException();
+        }
         Trie result;
-        result.AddChildren(0, args...);
+        result.nodes_.reserve(nodes_count);
+        Index edge = 0;
+        (result.AddChild(edge++, args), ...);
         return result;
     }
 
@@ -115,8 +80,35 @@ public:
         return number_terminals_;
     }
 
+    // Terminals in depth-first order with the edges of every node in increasing order
     std::vector<VertexPath> GetTerminals() const {
-        return root_->GetTerminals();
+        std::vector<VertexPath> result;
+        std::vector<size_t> path;
+        // Nodes on the path from the root with the next edge to try below each of them
+        std::vector<std::pair<Index, size_t>> stack = {{ROOT, 0}};
+        if (nodes_[ROOT].is_terminal) {
+            result.emplace_back(path, nodes_[ROOT].value);
+        }
+        while (!stack.empty()) {
+            auto &[node, edge] = stack.back();
+            while (edge < ALPHABET_SIZE && nodes_[node].children[edge] == NO_CHILD) {
+                ++edge;
+            }
+            if (edge == ALPHABET_SIZE) {
+                stack.pop_back();
+                if (!path.empty()) {
+                    path.pop_back();
+                }
+                continue;
+            }
+            const Index child = IndexOf(nodes_[node].children[edge]);
+            path.push_back(edge++);
+            if (nodes_[child].is_terminal) {
+                result.emplace_back(path, nodes_[child].value);
+            }
+            stack.emplace_back(child, 0);
+        }
+        return result;
     }
 
     template <typename Iterator>
@@ -134,27 +126,63 @@ public:
         return result;
     }
 
+    // Follows the edges that get_next returns down to a terminal, returns nullptr at a missing edge
     const T *TraverseOnce(const auto &get_next) const {
-        return root_->Traverse(get_next);
+        const TrieNode *nodes = nodes_.data();
+        const TrieNode *node = nodes + ROOT;
+        while (!node->is_terminal) {
+            const Link child = node->children[get_next()];
+            if (child == NO_CHILD) {
+                return nullptr;
+            }
+            node = Follow(nodes, child);
+        }
+        return &node->value;
     }
 
     template <typename Iterator>
     std::pair<const T *, Iterator> TraverseOnce(Iterator begin, Iterator end) const {
-        return root_->Traverse(begin, end);
+        const TrieNode *nodes = nodes_.data();
+        const TrieNode *node = nodes + ROOT;
+        while (!node->is_terminal) {
+            if (begin == end || node->children[*begin] == NO_CHILD) {
+                return {nullptr, begin};
+            }
+            node = Follow(nodes, node->children[*begin]);
+            ++begin;
+        }
+        return {&node->value, begin};
     }
 
 private:
-    std::unique_ptr<TrieNode> root_;
+    std::vector<TrieNode, Allocator<TrieNode>> nodes_;
     size_t number_terminals_;
 
-    void AddChildren(size_t edge) {
-        // Recursion Termination
+    static Link LinkTo(Index index) {
+        return static_cast<Link>(index * sizeof(TrieNode));
     }
 
-    template <typename... Args>
-    void AddChildren(size_t edge, Trie &child, Args &...args) {
-        root_->SetChildren(edge, child.root_);
+    static Index IndexOf(Link link) {
+        return static_cast<Index>(link / sizeof(TrieNode));
+    }
+
+    static const TrieNode *Follow(const TrieNode *nodes, Link link) {
+        return reinterpret_cast<const TrieNode *>(reinterpret_cast<const char *>(nodes) + link);
+    }
+
+    void AddChild(Index edge, Trie &child) {
+        const Link offset = LinkTo(static_cast<Index>(nodes_.size()));
+        for (TrieNode &node : child.nodes_) {
+            for (Link &grandchild : node.children) {
+                if (grandchild != NO_CHILD) {
+                    grandchild += offset;
+                }
+            }
+            nodes_.push_back(std::move(node));
+        }
+        nodes_[ROOT].children[edge] = offset;
         number_terminals_ += child.number_terminals_;
-        AddChildren(edge + 1, args...);
+        child.nodes_.assign(1, TrieNode());
+        child.number_terminals_ = 0;
     }
-};
\ No newline at end of file
+};
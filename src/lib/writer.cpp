@@ -1,49 +1,230 @@
 #include "writer.h"
+#include "stats.h"
 
+#include <algorithm>
 #include <bit>
+#include <cstring>
 #include <fstream>
+#include <iostream>
+#include <memory>
 #include <vector>
 #include <limits.h>
 
+namespace {
+
+void StoreBigEndian(char *data, uint64_t word) {
+    static_assert(std::endian::native == std::endian::little || std::endian::native == std::endian::big);
+    if constexpr (std::endian::native == std::endian::little) {
+        word = __builtin_bswap64(word);
+    }
+    std::memcpy(data, &word, sizeof(word));
+}
+
+}  // namespace
+
 Writer::Writer(const std::string& file_name, size_t buffer_byte_size)
-    : file_name_(file_name), stream_(file_name), data_(), buffer_size_(buffer_byte_size * CHAR_BIT) {
-    data_.reserve(buffer_size_);
+    : file_name_(file_name),
+      file_stream_(),
+      stream_(file_name == STANDARD_OUTPUT_NAME ? static_cast<std::ostream *>(&std::cout) : &file_stream_),
+      output_(nullptr),
+      data_(std::make_unique_for_overwrite<char[]>(buffer_byte_size + sizeof(uint64_t))),
+      data_size_(0),
+      bytes_written_(0),
+      bit_buffer_(0),
+      bits_used_(0),
+      buffer_size_(buffer_byte_size * CHAR_BIT),
+      spare_(),
+      spare_size_(0),
+      is_spare_pending_(false),
+      is_stopped_(false) {
+    if (stream_ == &file_stream_) {
+        file_stream_.open(file_name);
+    }
+}
+
+Writer::Writer(std::vector<char>& output, size_t buffer_byte_size)
+    : file_name_(),
+      file_stream_(),
+      stream_(nullptr),
+      output_(&output),
+      data_(std::make_unique_for_overwrite<char[]>(buffer_byte_size + sizeof(uint64_t))),
+      data_size_(0),
+      bytes_written_(0),
+      bit_buffer_(0),
+      bits_used_(0),
+      buffer_size_(buffer_byte_size * CHAR_BIT),
+      spare_(),
+      spare_size_(0),
+      is_spare_pending_(false),
+      is_stopped_(false) {
 }
 
 void Writer::WriteBit(bool value) {
-    data_.push_back(value);
-    if (data_.size() >= buffer_size_) {
-        UpdateBuffer();
-    }
+    WriteBits(value, 1);
 }
 
 void Writer::WriteBits(const std::vector<bool>& value) {
-    for (auto bit : value) {
-        WriteBit(bit);
+    size_t position = 0;
+    while (position < value.size()) {
+        const size_t chunk_size = std::min(value.size() - position, MAX_WRITE_BITS);
+        uint64_t chunk = 0;
+        for (size_t i = 0; i < chunk_size; ++i) {
+            chunk = (chunk << 1) | static_cast<uint64_t>(value[position + i]);
+        }
+        WriteBits(chunk, chunk_size);
+        position += chunk_size;
+    }
+}
+
+void Writer::WriteBytes(const char* data, size_t size) {
+    FlushBits();
+    const size_t buffer_byte_size = buffer_size_ / CHAR_BIT;
+    while (size > 0) {
+        const size_t chunk_size = std::min(size, buffer_byte_size - data_size_);
+        std::memcpy(data_.get() + data_size_, data, chunk_size);
+        data_size_ += chunk_size;
+        data += chunk_size;
+        size -= chunk_size;
+        if (data_size_ >= buffer_byte_size) {
+            UpdateBuffer();
+        }
+    }
+}
+
+void Writer::AppendBits(const char* data, size_t number_bits) {
+    if (bits_used_ % CHAR_BIT == 0) {
+        WriteBytes(data, number_bits / CHAR_BIT);
+    } else {
+        const size_t chunk_bytes = 7;  // Fits into one accumulator write
+        for (size_t i = 0; i < number_bits / CHAR_BIT; i += chunk_bytes) {
+            const size_t bytes = std::min(chunk_bytes, number_bits / CHAR_BIT - i);
+            uint64_t chunk = 0;
+            for (size_t j = 0; j < bytes; ++j) {
+                chunk = (chunk << CHAR_BIT) | static_cast<unsigned char>(data[i + j]);
+            }
+            WriteBits(chunk, bytes * CHAR_BIT);
+        }
+    }
+    if (const size_t rest = number_bits % CHAR_BIT) {
+        WriteBits(static_cast<unsigned char>(data[number_bits / CHAR_BIT]) >> (CHAR_BIT - rest), rest);
+    }
+}
+
+size_t Writer::GetBitsWritten() const {
+    return (bytes_written_ + data_size_) * CHAR_BIT + bits_used_;
+}
+
+void Writer::AlignToByte() {
+    if (bits_used_ % CHAR_BIT != 0) {
+        bits_used_ += CHAR_BIT - bits_used_ % CHAR_BIT;
+    }
+    FlushBits();
+}
+
+void Writer::Flush() {
+    AlignToByte();
+    UpdateBuffer();
+    WaitForOutput();
+    if (stream_ != nullptr) {
+        stream_->flush();
     }
 }
 
 void Writer::Clear() {
-    data_.clear();
-    stream_.close();
-    stream_.open(file_name_);
+    WaitForOutput();
+    data_size_ = 0;
+    bytes_written_ = 0;
+    bit_buffer_ = 0;
+    bits_used_ = 0;
+    if (output_ != nullptr) {
+        output_->clear();
+        return;
+    }
+    if (stream_ != &file_stream_) {
+        return;  // What went to the standard output can't be taken back
+    }
+    file_stream_.close();
+    file_stream_.open(file_name_);
 }
 
 Writer::~Writer() {
-    UpdateBuffer();
+    Flush();
+    if (output_thread_.joinable()) {
+        {
+            std::lock_guard lock(mutex_);
+            is_stopped_ = true;
+        }
+        state_changed_.notify_all();
+        output_thread_.join();
+    }
+}
+
+void Writer::FlushBits() {
+    const size_t bytes = bits_used_ / CHAR_BIT;
+    StoreBigEndian(data_.get() + data_size_, bit_buffer_);
+    data_size_ += bytes;
+    bit_buffer_ = bytes == sizeof(uint64_t) ? 0 : bit_buffer_ << (bytes * CHAR_BIT);
+    bits_used_ -= bytes * CHAR_BIT;
+    if (data_size_ * CHAR_BIT >= buffer_size_) {
+        UpdateBuffer();
+    }
 }
 
 bool Writer::UpdateBuffer() {
-    std::string char_data((data_.size() + CHAR_BIT - 1) / CHAR_BIT, 0);
-    for (size_t i = 0; i < data_.size(); ++i) {
-        static_assert(std::endian::native == std::endian::little || std::endian::native == std::endian::big);
-        if constexpr (std::endian::native == std::endian::big) {
-            char_data[i / CHAR_BIT] |= static_cast<char>(data_[i]) << (i % CHAR_BIT);
-        } else {
-            char_data[i / CHAR_BIT] |= static_cast<char>(data_[i]) << (CHAR_BIT - 1 - i % CHAR_BIT);
+    if (data_size_ == 0) {
+        return false;
+    }
+    Stats::Add(Stats::Counter::WriterFlushes, 1);
+    if (output_ != nullptr) {
+        Stats::PhaseTimer timer(Stats::Phase::WriteWait);
+        output_->insert(output_->end(), data_.get(), data_.get() + data_size_);
+    } else if (output_thread_.joinable() || data_size_ * CHAR_BIT >= buffer_size_) {
+        SubmitBuffer();
+    } else {
+        Stats::PhaseTimer timer(Stats::Phase::WriteWait);
+        stream_->write(data_.get(), static_cast<std::streamsize>(data_size_));
+    }
+    const bool written = data_size_ > 0;
+    bytes_written_ += data_size_;
+    data_size_ = 0;
+    return written;
+}
+
+void Writer::SubmitBuffer() {
+    if (!output_thread_.joinable()) {
+        spare_ = std::make_unique_for_overwrite<char[]>(buffer_size_ / CHAR_BIT + sizeof(uint64_t));
+        output_thread_ = std::thread([this]() { WriteSpares(); });
+    }
+    WaitForOutput();
+    {
+        std::lock_guard lock(mutex_);
+        std::swap(data_, spare_);
+        spare_size_ = data_size_;
+        is_spare_pending_ = true;
+    }
+    state_changed_.notify_all();
+}
+
+void Writer::WaitForOutput() {
+    if (!output_thread_.joinable()) {
+        return;
+    }
+    Stats::PhaseTimer timer(Stats::Phase::WriteWait);
+    std::unique_lock lock(mutex_);
+    state_changed_.wait(lock, [this]() { return !is_spare_pending_; });
+}
+
+void Writer::WriteSpares() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        state_changed_.wait(lock, [this]() { return is_spare_pending_ || is_stopped_; });
+        if (!is_spare_pending_) {
+            return;
         }
+        lock.unlock();
+        stream_->write(spare_.get(), static_cast<std::streamsize>(spare_size_));
+        lock.lock();
+        is_spare_pending_ = false;
+        state_changed_.notify_all();
     }
-    stream_.write(char_data.data(), static_cast<std::streamsize>(char_data.size()));
-    data_.clear();
-    return !char_data.empty();
 }
@@ -1,14 +1,38 @@
 #pragma once
 
+#include <condition_variable>
+#include <cstdint>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
 #include <vector>
 #include <limits.h>
 
+// Files and the standard output are double-buffered: once a buffer fills up, a background thread writes it
+// while the other one is filled, so the caller waits for the output only if it is slower. Outputs that
+// never fill a buffer are written without a thread
 class Writer {
     const static size_t DEFAULT_BUFFER_SIZE = 32768;
 
 public:
-    explicit Writer(const std::string &file_name, size_t buffer_byte_size = (DEFAULT_BUFFER_SIZE / CHAR_BIT));
+    inline const static size_t DEFAULT_FILE_BUFFER_BYTE_SIZE = 1 << 20;
+
+    // Maximum number of bits that a single accumulator write can take
+    static constexpr size_t MAX_WRITE_BITS = 57;
+
+    // File name that stands for the standard output
+    inline const static std::string STANDARD_OUTPUT_NAME = "-";
+
+    explicit Writer(const std::string &file_name, size_t buffer_byte_size = DEFAULT_FILE_BUFFER_BYTE_SIZE);
+
+    // Appends everything written to the output vector instead of a file
+    explicit Writer(std::vector<char> &output, size_t buffer_byte_size = (DEFAULT_BUFFER_SIZE / CHAR_BIT));
+
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
 
     void WriteBit(bool value);
 
@@ -17,22 +41,71 @@ public:
 
     void WriteBits(const std::vector<bool> &value);
 
+    // Must be called on a byte boundary
+    void WriteBytes(const char *data, size_t size);
+
+    // Writes the first number_bits bits of data at any bit position
+    void AppendBits(const char *data, size_t number_bits);
+
+    size_t GetBitsWritten() const;
+
+    // Pads the last byte with zero bits
+    void AlignToByte();
+
+    // Aligns to a byte and passes all buffered data to the output, waits until it is written
+    void Flush();
+
     void Clear();
 
     ~Writer();
 
 private:
     std::string file_name_;
-    std::ofstream stream_;
-    std::vector<bool> data_;
+    std::ofstream file_stream_;
+    std::ostream *stream_;
+    std::vector<char> *output_;
+    std::unique_ptr<char[]> data_;  // Not initialized, so that pages of large buffers are touched only when used
+    size_t data_size_;
+    size_t bytes_written_;
+    uint64_t bit_buffer_;  // Bits are appended below the most significant unused position
+    size_t bits_used_;
     const size_t buffer_size_ = DEFAULT_BUFFER_SIZE;
 
+    std::unique_ptr<char[]> spare_;  // Buffer that the output thread writes while data_ is filled
+    size_t spare_size_;
+    bool is_spare_pending_;          // spare_ holds data that is not written yet
+    bool is_stopped_;
+    std::mutex mutex_;
+    std::condition_variable state_changed_;
+    std::thread output_thread_;  // Started by the first full buffer
+
     bool UpdateBuffer();
+
+    void FlushBits();
+
+    // Hands data_ over to the output thread and takes the spare buffer
+    void SubmitBuffer();
+
+    void WaitForOutput();
+
+    void WriteSpares();
 };
 
 template <typename T>
 void Writer::WriteBits(T value, size_t number_bits) {
-    for (size_t i = number_bits; i > 0; --i) {
-        WriteBit((value >> (i - 1)) & 1);
+    if (number_bits == 0) {
+        return;
+    }
+    if (number_bits > MAX_WRITE_BITS) {
+        const size_t low_bits = number_bits - MAX_WRITE_BITS;
+        WriteBits(static_cast<uint64_t>(value) >> low_bits, MAX_WRITE_BITS);
+        WriteBits(static_cast<uint64_t>(value), low_bits);
+        return;
+    }
+    if (bits_used_ + number_bits > 64) {
+        FlushBits();
     }
+    const uint64_t bits = static_cast<uint64_t>(value) & (~uint64_t{0} >> (64 - number_bits));
+    bit_buffer_ |= bits << (64 - bits_used_ - number_bits);
+    bits_used_ += number_bits;
 }
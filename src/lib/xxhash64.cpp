@@ -0,0 +1,90 @@
+#include "xxhash64.h"
+
+#include <bit>
+#include <cstring>
+
+namespace {
+
+const uint64_t PRIME_1 = 0x9E3779B185EBCA87ull;
+const uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+const uint64_t PRIME_3 = 0x165667B19E3779F9ull;
+const uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ull;
+const uint64_t PRIME_5 = 0x27D4EB2F165667C5ull;
+
+inline uint64_t Load64(const char *data) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    static_assert(std::endian::native == std::endian::little || std::endian::native == std::endian::big);
+    if constexpr (std::endian::native == std::endian::big) {
+        word = __builtin_bswap64(word);
+    }
+    return word;
+}
+
+inline uint32_t Load32(const char *data) {
+    uint32_t word;
+    std::memcpy(&word, data, sizeof(word));
+    if constexpr (std::endian::native == std::endian::big) {
+        word = __builtin_bswap32(word);
+    }
+    return word;
+}
+
+inline uint64_t Round(uint64_t accumulator, uint64_t input) {
+    accumulator += input * PRIME_2;
+    return std::rotl(accumulator, 31) * PRIME_1;
+}
+
+inline uint64_t MergeRound(uint64_t accumulator, uint64_t value) {
+    accumulator ^= Round(0, value);
+    return accumulator * PRIME_1 + PRIME_4;
+}
+
+}  // namespace
+
+uint64_t Xxh64(const char *data, size_t size, uint64_t seed) {
+    const char *const end = data + size;
+    uint64_t hash;
+    if (size >= 32) {
+        // Four independent lanes over 32-byte stripes
+        uint64_t lane_1 = seed + PRIME_1 + PRIME_2;
+        uint64_t lane_2 = seed + PRIME_2;
+        uint64_t lane_3 = seed;
+        uint64_t lane_4 = seed - PRIME_1;
+        for (; end - data >= 32; data += 32) {
+            lane_1 = Round(lane_1, Load64(data));
+            lane_2 = Round(lane_2, Load64(data + 8));
+            lane_3 = Round(lane_3, Load64(data + 16));
+            lane_4 = Round(lane_4, Load64(data + 24));
+        }
+        hash = std::rotl(lane_1, 1) + std::rotl(lane_2, 7) + std::rotl(lane_3, 12) + std::rotl(lane_4, 18);
+        hash = MergeRound(hash, lane_1);
+        hash = MergeRound(hash, lane_2);
+        hash = MergeRound(hash, lane_3);
+        hash = MergeRound(hash, lane_4);
+    } else {
+        hash = seed + PRIME_5;
+    }
+    hash += size;
+
+    for (; end - data >= 8; data += 8) {
+        hash ^= Round(0, Load64(data));
+        hash = std::rotl(hash, 27) * PRIME_1 + PRIME_4;
+    }
+    if (end - data >= 4) {
+        hash ^= Load32(data) * PRIME_1;
+        hash = std::rotl(hash, 23) * PRIME_2 + PRIME_3;
+        data += 4;
+    }
+    for (; data < end; ++data) {
+        hash ^= static_cast<unsigned char>(*data) * PRIME_5;
+        hash = std::rotl(hash, 11) * PRIME_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// XXH64, the 64-bit non-cryptographic hash of the xxHash family
+uint64_t Xxh64(const char *data, size_t size, uint64_t seed = 0);
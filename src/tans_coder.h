@@ -0,0 +1,232 @@
+#pragma once
+
+#include "lib/histogram.h"
+#include "lib/reader.h"
+#include "lib/writer.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Table-based asymmetric numeral system coder for bytes (tANS, the scheme of FSE). Byte counts are scaled
+// to a power of two, and every byte owns as many of the table states as its scaled count, so a byte
+// costs log2(table size / count) bits on average instead of a whole number of bits. Bytes are encoded
+// from the last to the first, so that the decoder reads the codes forward.
+//
+// The table is written as its log (4 bits) and the 256 scaled counts, each as count + 1 in Elias gamma
+// code. It is followed by the state of the decoder before the first byte (table log bits) and the bits
+// that every byte but the last one moves the state by.
+namespace tans {
+
+inline const size_t MIN_TABLE_LOG = 5;
+inline const size_t MAX_TABLE_LOG = 12;
+inline const size_t DEFAULT_TABLE_LOG = 11;
+inline const size_t TABLE_LOG_SIZE = 4;
+
+using ScaledCounts = std::array<uint32_t, 256>;
+
+// Small tables for small inputs, but enough states for every byte value that occurs
+inline size_t ChooseTableLog(const ByteHistogram &histogram) {
+    uint64_t total = 0;
+    size_t symbols_count = 0;
+    for (uint64_t count : histogram) {
+        total += count;
+        symbols_count += count != 0;
+    }
+    const size_t table_log = std::min<size_t>(DEFAULT_TABLE_LOG, std::bit_width(total));
+    return std::clamp<size_t>(std::max<size_t>(table_log, std::bit_width(symbols_count) + 1), MIN_TABLE_LOG,
+                              MAX_TABLE_LOG);
+}
+
+// Rounds the counts to a sum of 2^table_log keeping every occurring byte, then moves the rounding error
+// to the bytes whose cost changes least. An empty histogram gives the whole table to byte 0
+inline ScaledCounts ScaleCounts(const ByteHistogram &histogram, size_t table_log) {
+    const uint64_t table_size = uint64_t{1} << table_log;
+    uint64_t total = 0;
+    for (uint64_t count : histogram) {
+        total += count;
+    }
+    ScaledCounts scaled = {};
+    if (total == 0) {
+        scaled[0] = static_cast<uint32_t>(table_size);
+        return scaled;
+    }
+    int64_t error = static_cast<int64_t>(table_size);
+    for (size_t value = 0; value < histogram.size(); ++value) {
+        if (histogram[value] != 0) {
+            const uint64_t rounded = (histogram[value] * table_size + total / 2) / total;
+            scaled[value] = static_cast<uint32_t>(std::max<uint64_t>(rounded, 1));
+            error -= scaled[value];
+        }
+    }
+    for (; error != 0; error += error > 0 ? -1 : 1) {
+        size_t best = histogram.size();
+        double best_cost = 0;
+        for (size_t value = 0; value < histogram.size(); ++value) {
+            if (histogram[value] == 0 || (error < 0 && scaled[value] == 1)) {
+                continue;
+            }
+            // Bits gained by one more state, or lost by one less
+            const double count = static_cast<double>(histogram[value]);
+            const double cost = error > 0 ? count * std::log2((scaled[value] + 1.0) / scaled[value])
+                                          : -count * std::log2(scaled[value] / (scaled[value] - 1.0));
+            if (best == histogram.size() || cost > best_cost) {
+                best = value;
+                best_cost = cost;
+            }
+        }
+        scaled[best] += error > 0 ? 1 : -1;
+    }
+    return scaled;
+}
+
+// Byte that owns every state. The odd step visits all states of a table of at least 16 states once and
+// scatters the states of a byte over the table
+inline std::vector<unsigned char> SpreadSymbols(const ScaledCounts &counts, size_t table_log) {
+    const size_t table_size = size_t{1} << table_log;
+    const size_t step = (table_size >> 1) + (table_size >> 3) + 3;
+    std::vector<unsigned char> symbols(table_size);
+    size_t position = 0;
+    for (size_t value = 0; value < counts.size(); ++value) {
+        for (uint32_t i = 0; i < counts[value]; ++i) {
+            symbols[position] = static_cast<unsigned char>(value);
+            position = (position + step) & (table_size - 1);
+        }
+    }
+    return symbols;
+}
+
+};  // namespace tans
+
+class TansEncoder {
+public:
+    explicit TansEncoder(const ByteHistogram &histogram)
+        : table_log_(tans::ChooseTableLog(histogram)), counts_(tans::ScaleCounts(histogram, table_log_)) {
+        const size_t table_size = size_t{1} << table_log_;
+        std::array<uint32_t, 256> next = {};
+        uint32_t start = 0;
+        for (size_t value = 0; value < counts_.size(); ++value) {
+            Symbol &symbol = symbols_[value];
+            if (counts_[value] != 0) {
+                symbol.count = counts_[value];
+                symbol.bits = static_cast<uint32_t>(table_log_ + 1 - std::bit_width(counts_[value]));
+                symbol.threshold = symbol.count << symbol.bits;
+                symbol.start = start;
+                next[value] = start;
+                start += counts_[value];
+            }
+        }
+        const std::vector<unsigned char> spread = tans::SpreadSymbols(counts_, table_log_);
+        next_states_.resize(table_size);
+        for (uint32_t state = 0; state < table_size; ++state) {
+            next_states_[next[spread[state]]++] = static_cast<uint16_t>(state + table_size);
+        }
+    }
+
+    void WriteTable(Writer &writer) const {
+        writer.WriteBits(table_log_, tans::TABLE_LOG_SIZE);
+        for (uint32_t count : counts_) {
+            const size_t width = std::bit_width(count + 1);
+            writer.WriteBits(0, width - 1);
+            writer.WriteBits(count + 1, width);
+        }
+    }
+
+    void Encode(std::span<const char> data, Writer &writer) const {
+        const size_t table_size = size_t{1} << table_log_;
+        // Every entry packs the bits that decoding the byte at its index is followed by and their number
+        std::vector<uint16_t> moves(data.size());
+        size_t state = table_size;
+        for (size_t i = data.size(); i-- > 0;) {
+            const Symbol &symbol = symbols_[static_cast<unsigned char>(data[i])];
+            const uint32_t bits = symbol.bits - (state < symbol.threshold);
+            moves[i] = static_cast<uint16_t>(((state & ((1u << bits) - 1)) << MOVE_LENGTH_BITS) | bits);
+            state = next_states_[symbol.start + (state >> bits) - symbol.count];
+        }
+        writer.WriteBits(state - table_size, table_log_);
+        for (size_t i = 0; i + 1 < moves.size(); ++i) {
+            writer.WriteBits(moves[i] >> MOVE_LENGTH_BITS, moves[i] & ((1u << MOVE_LENGTH_BITS) - 1));
+        }
+    }
+
+private:
+    const static size_t MOVE_LENGTH_BITS = 4;
+
+    struct Symbol {
+        uint32_t count = 0;
+        uint32_t bits = 0;       // Bits output for states of at least threshold, one less below it
+        uint32_t threshold = 0;
+        uint32_t start = 0;      // First next state of the symbol in next_states_
+    };
+
+    size_t table_log_;
+    tans::ScaledCounts counts_;
+    std::array<Symbol, 256> symbols_ = {};
+    std::vector<uint16_t> next_states_;
+};
+
+class TansDecoder {
+public:
+    class InvalidTableException : public std::exception {};
+
+    // Reads the table written by TansEncoder::WriteTable
+    explicit TansDecoder(Reader &reader) : table_log_(reader.ReadBits<size_t>(tans::TABLE_LOG_SIZE)) {
+        if (table_log_ < tans::MIN_TABLE_LOG || table_log_ > tans::MAX_TABLE_LOG) {
+            throw InvalidTableException();
+        }
+        const size_t table_size = size_t{1} << table_log_;
+        tans::ScaledCounts counts = {};
+        size_t total = 0;
+        for (uint32_t &count : counts) {
+            size_t zeros = 0;
+            while (!reader.ReadBit()) {
+                if (++zeros > tans::MAX_TABLE_LOG) {
+                    throw InvalidTableException();
+                }
+            }
+            count = static_cast<uint32_t>(((size_t{1} << zeros) | reader.ReadBits<size_t>(zeros)) - 1);
+            total += count;
+        }
+        if (total != table_size) {
+            throw InvalidTableException();
+        }
+
+        const std::vector<unsigned char> spread = tans::SpreadSymbols(counts, table_log_);
+        table_.resize(table_size);
+        std::array<uint32_t, 256> next = counts;
+        for (size_t i = 0; i < table_size; ++i) {
+            Entry &entry = table_[i];
+            entry.symbol = static_cast<char>(spread[i]);
+            const uint32_t state = next[spread[i]]++;
+            entry.bits = static_cast<uint8_t>(table_log_ + 1 - std::bit_width(state));
+            entry.base = static_cast<uint16_t>((state << entry.bits) - table_size);
+        }
+    }
+
+    void Decode(Reader &reader, char *data, size_t size) const {
+        if (size == 0) {
+            return;
+        }
+        size_t state = reader.ReadBits<size_t>(table_log_);
+        for (size_t i = 0; i + 1 < size; ++i) {
+            const Entry &entry = table_[state];
+            data[i] = entry.symbol;
+            state = entry.base + reader.ReadBits<size_t>(entry.bits);
+        }
+        data[size - 1] = table_[state].symbol;
+    }
+
+private:
+    struct Entry {
+        uint16_t base = 0;  // Next state without the bits read after the symbol
+        char symbol = 0;
+        uint8_t bits = 0;
+    };
+
+    size_t table_log_;
+    std::vector<Entry> table_;
+};
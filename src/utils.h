@@ -1,4 +0,0 @@
-#pragma once
-#include <vector>
-
-bool IncreasePath(std::vector<bool> &path);
\ No newline at end of file
@@ -25,4 +25,24 @@ TEST_CASE("MultiIntArgument") {
 TEST_CASE("FlagArgument") {
     CLAParser parser;
     parser.AddFlag('f', "flag", "help");
-}
\ No newline at end of file
+}
+TEST_CASE("ParseValues") {
+    CLAParser parser;
+    parser.AddArgument<int>('i', "int", "integer", "help", false);
+    parser.AddArgument<std::string>('s', "str", "string", "help", false);
+    parser.AddFlag('f', "flag", "help");
+    parser.AddMultipleArguments<std::string>("string", "help", false);
+
+    std::vector<std::string> args = {"program", "-f", "-", "--int", "15", "--str=abc", "path"};
+    std::vector<char *> argv;
+    for (auto &arg : args) {
+        argv.push_back(arg.data());
+    }
+    REQUIRE(parser.Parse(static_cast<int>(argv.size()), argv.data()));
+    REQUIRE(*parser.GetArgumentValue<bool>("flag"));
+    REQUIRE(*parser.GetArgumentValue<int>("int") == 15);
+    REQUIRE(*parser.GetArgumentValue<std::string>("str") == "abc");
+    REQUIRE(parser.GetMultiplyArgumentsNumber<std::string>() == 2);
+    REQUIRE(*parser.GetMultiplyArgumentValue<std::string>(0) == "-");
+    REQUIRE(*parser.GetMultiplyArgumentValue<std::string>(1) == "path");
+}
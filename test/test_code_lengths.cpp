@@ -0,0 +1,72 @@
+#include <catch.hpp>
+
+#include "../src/code_lengths.h"
+
+#include <vector>
+
+TEST_CASE("KnownLengths") {
+    const std::vector<std::pair<size_t, char>> occurrences = {{5, 'a'}, {9, 'b'}, {12, 'c'}, {13, 'd'}, {16, 'e'},
+                                                              {45, 'f'}};
+    const std::vector<std::pair<size_t, char>> expected = {{1, 'f'}, {3, 'c'}, {3, 'd'}, {3, 'e'}, {4, 'a'},
+                                                           {4, 'b'}};
+    REQUIRE(HuffmanCodeLengths(occurrences) == expected);
+}
+
+TEST_CASE("SingleSymbol") {
+    const std::vector<std::pair<size_t, char>> expected = {{0, 'a'}};
+    REQUIRE(HuffmanCodeLengths(std::vector<std::pair<size_t, char>>{{3, 'a'}}) == expected);
+}
+
+TEST_CASE("CanonicalCodesArePrefixFree") {
+    std::vector<std::pair<size_t, int>> occurrences;
+    for (int i = 0; i < 300; ++i) {
+        occurrences.emplace_back((i * i) % 97 + 1, i);
+    }
+    const auto canonical_order = HuffmanCodeLengths(occurrences);
+    const auto codes = CanonicalCodes(canonical_order);
+
+    double kraft_sum = 0;
+    for (size_t i = 0; i < canonical_order.size(); ++i) {
+        kraft_sum += 1.0 / static_cast<double>(uint64_t{1} << canonical_order[i].first);
+        for (size_t j = 0; j < i; ++j) {
+            const size_t shift = canonical_order[i].first - canonical_order[j].first;
+            REQUIRE((codes[i] >> shift) != codes[j]);
+        }
+    }
+    REQUIRE(kraft_sum == 1.0);
+}
+
+TEST_CASE("LimitedLengths") {
+    // Fibonacci weights give the longest possible Huffman codes
+    std::vector<std::pair<size_t, int>> occurrences;
+    size_t previous = 1;
+    size_t current = 1;
+    for (int i = 0; i < 30; ++i) {
+        occurrences.emplace_back(current, i);
+        std::tie(previous, current) = std::make_pair(current, previous + current);
+    }
+    auto cost = [&](const std::vector<std::pair<size_t, int>> &canonical_order) {
+        size_t total = 0;
+        for (const auto &[code_length, character] : canonical_order) {
+            total += code_length * occurrences[character].first;
+        }
+        return total;
+    };
+
+    const auto unlimited = HuffmanCodeLengths(occurrences);
+    REQUIRE(unlimited.back().first == 29);
+    REQUIRE(LimitedCodeLengths(occurrences, 29) == unlimited);
+
+    for (size_t max_length : {5, 8, 12, 20}) {
+        const auto limited = LimitedCodeLengths(occurrences, max_length);
+        REQUIRE(limited.size() == occurrences.size());
+        REQUIRE(limited.back().first <= max_length);
+        REQUIRE(cost(limited) >= cost(unlimited));
+
+        double kraft_sum = 0;
+        for (const auto &[code_length, character] : limited) {
+            kraft_sum += 1.0 / static_cast<double>(uint64_t{1} << code_length);
+        }
+        REQUIRE(kraft_sum == 1.0);
+    }
+}
@@ -0,0 +1,29 @@
+#include <catch.hpp>
+
+#include "../src/lib/crc32c.h"
+
+#include <random>
+#include <string>
+
+TEST_CASE("KnownChecksums") {
+    REQUIRE(Crc32c(nullptr, 0) == 0);
+    const std::string check = "123456789";
+    REQUIRE(Crc32c(check.data(), check.size()) == 0xE3069283);
+    const std::string zeros(32, 0);
+    REQUIRE(Crc32c(zeros.data(), zeros.size()) == 0x8A9136AA);
+}
+
+TEST_CASE("ExtendAndCombine") {
+    std::mt19937 generator(7);
+    std::string data(1000, 0);
+    for (char &value : data) {
+        value = static_cast<char>(generator());
+    }
+    const uint32_t whole = Crc32c(data.data(), data.size());
+    for (size_t split : {0, 1, 7, 8, 9, 500, 999, 1000}) {
+        const uint32_t head = Crc32c(data.data(), split);
+        const uint32_t tail = Crc32c(data.data() + split, data.size() - split);
+        REQUIRE(Crc32c(data.data() + split, data.size() - split, head) == whole);
+        REQUIRE(Crc32cCombine(head, tail, data.size() - split) == whole);
+    }
+}
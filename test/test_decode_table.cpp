@@ -0,0 +1,57 @@
+#include <catch.hpp>
+
+#include "../src/decode_table.h"
+#include "../src/lib/writer.h"
+
+#include <vector>
+
+TEST_CASE("PrimarySecondaryAndLongCodes") {
+    // Lengths 1, 2, ..., 28, 29, 29: code of length l < 29 is (l - 1) ones followed by a zero
+    const size_t max_length = 29;
+    std::vector<std::pair<size_t, int>> canonical_order;
+    for (size_t length = 1; length <= max_length; ++length) {
+        canonical_order.emplace_back(length, static_cast<int>(length));
+    }
+    canonical_order.emplace_back(max_length, 0);
+
+    auto code = [&](int symbol) -> std::pair<uint64_t, size_t> {
+        if (symbol == 0) {
+            return {(uint64_t{1} << max_length) - 1, max_length};
+        }
+        return {(uint64_t{1} << symbol) - 2, symbol};
+    };
+
+    std::vector<int> message;
+    for (size_t i = 0; i < 1000; ++i) {
+        message.push_back(static_cast<int>((i * 7) % (max_length + 1)));
+    }
+    {
+        Writer writer("___tmp");
+        for (int symbol : message) {
+            auto [bits, length] = code(symbol);
+            writer.WriteBits(bits, length);
+        }
+    }
+    DecodeTable<int> table(canonical_order);
+    REQUIRE(table.GetMaxCodeLength() == max_length);
+    Reader reader("___tmp");
+    for (int symbol : message) {
+        const int *decoded = table.Decode(reader);
+        REQUIRE(decoded != nullptr);
+        REQUIRE(*decoded == symbol);
+    }
+    std::remove("___tmp");
+}
+
+TEST_CASE("InvalidCodes") {
+    REQUIRE_THROWS_AS(DecodeTable<int>({{1, 0}, {1, 1}, {1, 2}}), DecodeTable<int>::InvalidCodeException);
+
+    {
+        Writer writer("___tmp");
+        writer.WriteBits(1, 1);
+    }
+    DecodeTable<int> table({{1, 5}});
+    Reader reader("___tmp");
+    REQUIRE(table.Decode(reader) == nullptr);
+    std::remove("___tmp");
+}
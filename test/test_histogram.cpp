@@ -0,0 +1,35 @@
+#include <catch.hpp>
+
+#include "../src/lib/histogram.h"
+
+#include <random>
+#include <vector>
+
+TEST_CASE("MatchesNaiveCount") {
+    std::mt19937 generator(3);
+    std::vector<char> data(5000);
+    for (char &value : data) {
+        value = static_cast<char>(generator() % 4 == 0 ? 'e' : generator());
+    }
+    for (size_t offset : {0, 1, 3, 8}) {
+        for (size_t size : {0, 1, 15, 16, 17, 100, 4000}) {
+            ByteHistogram expected = {};
+            for (size_t i = offset; i < offset + size; ++i) {
+                ++expected[static_cast<unsigned char>(data[i])];
+            }
+            ByteHistogram histogram = {};
+            CountBytes(data.data() + offset, size, histogram);
+            REQUIRE(histogram == expected);
+        }
+    }
+}
+
+TEST_CASE("AddsToHistogram") {
+    const std::vector<char> data(1000, 'a');
+    ByteHistogram histogram = {};
+    histogram['a'] = 5;
+    CountBytes(data.data(), data.size(), histogram);
+    CountBytes(data.data(), 10, histogram);
+    REQUIRE(histogram['a'] == 1015);
+    REQUIRE(histogram['b'] == 0);
+}
@@ -0,0 +1,65 @@
+#include <catch.hpp>
+
+#include "../src/lib/lz77.h"
+
+#include <random>
+#include <string>
+
+namespace {
+
+std::string Reconstruct(const std::string &data, const std::vector<LzMatch> &matches) {
+    std::string result;
+    for (const LzMatch &match : matches) {
+        REQUIRE(match.position >= result.size());
+        result += data.substr(result.size(), match.position - result.size());
+        REQUIRE(match.length >= lz77::MIN_MATCH);
+        REQUIRE(match.length <= lz77::MAX_MATCH);
+        REQUIRE(match.distance >= 1);
+        REQUIRE(match.distance <= result.size());
+        for (size_t i = 0; i < match.length; ++i) {
+            result += result[result.size() - match.distance];
+        }
+    }
+    result += data.substr(std::min(result.size(), data.size()));
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("ValueCodes") {
+    for (uint32_t value : {0u, 1u, 3u, 4u, 5u, 6u, 7u, 8u, 100u, 65535u, (1u << 30) - 1}) {
+        const lz77::ValueCode code = lz77::SplitValue(value);
+        REQUIRE(code.code < lz77::DISTANCE_CODES_COUNT);
+        REQUIRE(code.extra_bits_count == lz77::ExtraBitsCount(code.code));
+        REQUIRE(code.extra_bits < (1u << code.extra_bits_count));
+        REQUIRE(lz77::JoinValue(code.code, code.extra_bits) == value);
+    }
+    REQUIRE(lz77::SplitValue(lz77::MAX_MATCH - lz77::MIN_MATCH).code < lz77::LENGTH_CODES_COUNT);
+    REQUIRE(lz77::SplitValue(4).code == 4);
+    REQUIRE(lz77::SplitValue(6).code == 5);
+}
+
+TEST_CASE("MatchesReconstructData") {
+    std::mt19937 generator(11);
+    std::string data;
+    for (size_t i = 0; i < 2000; ++i) {
+        data += "line " + std::to_string(generator() % 50) + (generator() % 3 == 0 ? " error\n" : " ok\n");
+    }
+    for (size_t depth : {1, 4, 64}) {
+        const std::vector<LzMatch> matches = FindMatches(data, depth);
+        REQUIRE(!matches.empty());
+        REQUIRE(Reconstruct(data, matches) == data);
+    }
+    REQUIRE(FindMatches(data, 0).empty());
+}
+
+TEST_CASE("LongRunsAndShortInputs") {
+    const std::string run(200000, 'a');
+    const std::vector<LzMatch> matches = FindMatches(run, 8);
+    REQUIRE(matches.size() <= 4);
+    REQUIRE(matches.front().distance == 1);
+    REQUIRE(Reconstruct(run, matches) == run);
+    for (const std::string data : {"", "abc", "abcd", "abcdabcd"}) {
+        REQUIRE(Reconstruct(data, FindMatches(data, 8)) == data);
+    }
+}
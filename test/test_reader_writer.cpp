@@ -3,6 +3,9 @@
 #include "../src/lib/writer.h"
 #include "../src/lib/reader.h"
 
+#include <algorithm>
+#include <filesystem>
+
 TEST_CASE("CharsWriteRead") {
     {
         Writer writer("___tmp");
@@ -37,4 +40,171 @@ TEST_CASE("IntsWriteRead") {
         REQUIRE(reader.ReadBits<int>(15) == 4);
     }
     std::remove("__tmp");
-}
\ No newline at end of file
+}
+
+TEST_CASE("MixedWidthsWriteRead") {
+    const size_t count = 10000;
+    {
+        Writer writer("___tmp", 16);
+        for (size_t i = 0; i < count; ++i) {
+            writer.WriteBits(i, i % 57 + 1);
+            writer.WriteBit(i % 3 == 0);
+        }
+        writer.WriteBits(0x123456789abcdef0ull, 64);
+    }
+    {
+        Reader reader("___tmp", 16);
+        for (size_t i = 0; i < count; ++i) {
+            const size_t width = i % 57 + 1;
+            REQUIRE(reader.ReadBits<size_t>(width) == (i & (~0ull >> (64 - width))));
+            REQUIRE(reader.ReadBit() == (i % 3 == 0));
+        }
+        REQUIRE(reader.ReadBits<uint64_t>(64) == 0x123456789abcdef0ull);
+    }
+    std::remove("___tmp");
+}
+
+TEST_CASE("BufferSizedFileEof") {
+    {
+        Writer writer("___tmp", 8);
+        for (size_t i = 0; i < 16; ++i) {
+            writer.WriteBits(i, 8);
+        }
+    }
+    {
+        Reader reader("___tmp", 8);
+        for (size_t i = 0; i < 16; ++i) {
+            REQUIRE(!reader.IsEof());
+            REQUIRE(reader.ReadBits<size_t>(8) == i);
+        }
+        REQUIRE(reader.IsEof());
+        REQUIRE_THROWS(reader.ReadBit());
+    }
+    std::remove("___tmp");
+}
+
+TEST_CASE("BitsThenBytes") {
+    {
+        Writer writer("___tmp", 8);
+        writer.WriteBits(0xab, 8);
+        for (size_t i = 0; i < 100; ++i) {
+            writer.WriteBits(i, 8);
+        }
+    }
+    {
+        Reader reader("___tmp", 8);
+        REQUIRE(reader.ReadBits<int>(4) == 0xa);
+        REQUIRE(reader.ReadBits<int>(4) == 0xb);
+        std::vector<char> data(200);
+        REQUIRE(reader.ReadBytes(data.data(), data.size()) == 100);
+        for (size_t i = 0; i < 100; ++i) {
+            REQUIRE(data[i] == static_cast<char>(i));
+        }
+        REQUIRE(reader.IsEof());
+    }
+    std::remove("___tmp");
+}
+
+TEST_CASE("MemoryWriteRead") {
+    std::vector<char> output;
+    {
+        Writer writer(output, 4);
+        writer.WriteBits(5, 3);
+        writer.AlignToByte();
+        writer.WriteBytes("abcdefghij", 10);
+        writer.WriteBits(1, 1);
+    }
+    REQUIRE(output.size() == 12);
+    REQUIRE(output[0] == static_cast<char>(0xa0));
+
+    Reader reader(output);
+    REQUIRE(reader.ReadBits<int>(3) == 5);
+    reader.AlignToByte();
+    std::string data(10, 0);
+    REQUIRE(reader.ReadBytes(data.data(), data.size()) == 10);
+    REQUIRE(data == "abcdefghij");
+    REQUIRE(reader.ReadBit());
+    reader.AlignToByte();
+    REQUIRE(reader.IsEof());
+}
+
+TEST_CASE("SeekAndTell") {
+    std::vector<char> output;
+    {
+        Writer writer("___tmp", 8);
+        Writer memory_writer(output, 8);
+        for (size_t i = 0; i < 100; ++i) {
+            writer.WriteBits(i, 8);
+            memory_writer.WriteBits(i, 8);
+        }
+    }
+    Reader file_reader("___tmp", 8);
+    Reader memory_reader(output);
+    for (Reader *reader : {&file_reader, &memory_reader}) {
+        REQUIRE(reader->GetSize() == 100);
+        REQUIRE(reader->ReadBits<size_t>(24) == 0x000102);
+        REQUIRE(reader->Tell() == 3);
+        for (size_t offset : {90, 5, 17, 0, 99}) {
+            reader->Seek(offset);
+            REQUIRE(reader->Tell() == offset);
+            REQUIRE(reader->ReadBits<size_t>(8) == offset);
+            REQUIRE(reader->Tell() == offset + 1);
+        }
+        REQUIRE(reader->IsEof());
+        reader->Seek(40);
+        std::vector<char> data(10);
+        REQUIRE(reader->ReadBytes(data.data(), data.size()) == 10);
+        REQUIRE(data[9] == 49);
+        REQUIRE(reader->Tell() == 50);
+    }
+    std::remove("___tmp");
+}
+
+TEST_CASE("BackgroundFileWrites") {
+    std::vector<char> data(10000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>(i * 7);
+    }
+    {
+        Writer writer("___tmp", 16);
+        writer.WriteBytes(data.data(), data.size());
+        writer.WriteBits(3, 2);
+        writer.Flush();
+        REQUIRE(std::filesystem::file_size("___tmp") == data.size() + 1);
+        writer.Clear();
+        writer.WriteBytes(data.data(), 100);
+    }
+    Reader reader("___tmp", 16);
+    REQUIRE(reader.GetSize() == 100);
+    std::vector<char> read(100);
+    REQUIRE(reader.ReadBytes(read.data(), read.size()) == read.size());
+    REQUIRE(std::equal(read.begin(), read.end(), data.begin()));
+    std::remove("___tmp");
+}
+
+TEST_CASE("ReadAheadAndSeek") {
+    std::vector<char> data(10000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>(i * 7);
+    }
+    {
+        Writer writer("___tmp", 16);
+        writer.WriteBytes(data.data(), data.size());
+    }
+    Reader reader("___tmp", 16);
+    for (size_t i = 0; i < 5000; ++i) {
+        REQUIRE(reader.ReadBits<char>(CHAR_BIT) == data[i]);
+    }
+    for (size_t offset : {9990, 17, 4096}) {
+        reader.Seek(offset);
+        REQUIRE(reader.ReadBits<char>(CHAR_BIT) == data[offset]);
+    }
+    std::vector<char> rest(data.size());
+    REQUIRE(reader.ReadBytes(rest.data(), rest.size()) == data.size() - 4097);
+    REQUIRE(std::equal(data.begin() + 4097, data.end(), rest.begin()));
+    REQUIRE(reader.IsEof());
+    reader.Reload();
+    REQUIRE(!reader.IsEof());
+    REQUIRE(reader.ReadBits<char>(CHAR_BIT) == data[0]);
+    std::remove("___tmp");
+}
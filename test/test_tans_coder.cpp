@@ -0,0 +1,93 @@
+#include <catch.hpp>
+
+#include "../src/tans_coder.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<char> EncodeTans(const std::vector<char> &data) {
+    ByteHistogram histogram = {};
+    CountBytes(data.data(), data.size(), histogram);
+    std::vector<char> output;
+    {
+        Writer writer(output);
+        TansEncoder encoder(histogram);
+        encoder.WriteTable(writer);
+        encoder.Encode(data, writer);
+    }
+    return output;
+}
+
+std::vector<char> DecodeTans(std::vector<char> encoded, size_t size) {
+    Reader reader(std::move(encoded));
+    TansDecoder decoder(reader);
+    std::vector<char> data(size);
+    decoder.Decode(reader, data.data(), data.size());
+    return data;
+}
+
+}  // namespace
+
+TEST_CASE("RoundTrip") {
+    std::mt19937 generator(5);
+    std::geometric_distribution<int> skewed(0.3);
+    for (size_t size : {0, 1, 2, 17, 1000, 100000}) {
+        std::vector<char> data(size);
+        for (char &value : data) {
+            value = static_cast<char>(generator() % 8 == 0 ? generator() : skewed(generator));
+        }
+        REQUIRE(DecodeTans(EncodeTans(data), size) == data);
+    }
+}
+
+TEST_CASE("SingleByteCostsNothing") {
+    const std::vector<char> data(100000, 'x');
+    const std::vector<char> encoded = EncodeTans(data);
+    REQUIRE(encoded.size() < 64);
+    REQUIRE(DecodeTans(encoded, data.size()) == data);
+}
+
+TEST_CASE("CloseToEntropy") {
+    // Two bytes with probabilities 0.95 and 0.05 need 0.29 bits each, a prefix code needs 1
+    std::mt19937 generator(7);
+    std::vector<char> data(100000);
+    for (char &value : data) {
+        value = generator() % 20 == 0 ? 'b' : 'a';
+    }
+    const std::vector<char> encoded = EncodeTans(data);
+    const double entropy = -(0.95 * std::log2(0.95) + 0.05 * std::log2(0.05));
+    REQUIRE(encoded.size() * CHAR_BIT < data.size() * entropy * 1.02);
+    REQUIRE(DecodeTans(encoded, data.size()) == data);
+}
+
+TEST_CASE("ScaledCountsSumToTable") {
+    ByteHistogram histogram = {};
+    histogram[0] = 1000000;
+    for (size_t value = 1; value < histogram.size(); ++value) {
+        histogram[value] = 1;
+    }
+    const size_t table_log = tans::ChooseTableLog(histogram);
+    const tans::ScaledCounts counts = tans::ScaleCounts(histogram, table_log);
+    uint64_t total = 0;
+    for (size_t value = 0; value < counts.size(); ++value) {
+        REQUIRE(counts[value] >= 1);
+        total += counts[value];
+    }
+    REQUIRE(total == (uint64_t{1} << table_log));
+}
+
+TEST_CASE("InvalidTable") {
+    std::vector<char> encoded;
+    {
+        Writer writer(encoded);
+        writer.WriteBits(tans::DEFAULT_TABLE_LOG, tans::TABLE_LOG_SIZE);
+        for (size_t value = 0; value < 256; ++value) {
+            writer.WriteBits(0b010, 3);  // Every count is 1, far from the table size
+        }
+    }
+    Reader reader(std::move(encoded));
+    REQUIRE_THROWS_AS(TansDecoder(reader), TansDecoder::InvalidTableException);
+}
@@ -0,0 +1,37 @@
+#include <catch.hpp>
+
+#include "../src/lib/thread_pool.h"
+
+#include <atomic>
+#include <vector>
+
+TEST_CASE("ResultsInOrder") {
+    for (size_t threads_count : {0, 1, 4}) {
+        ThreadPool pool(threads_count);
+        REQUIRE(pool.GetThreadsCount() == threads_count);
+        std::vector<std::future<size_t>> results;
+        for (size_t i = 0; i < 1000; ++i) {
+            results.push_back(pool.Submit([i]() { return i * i; }));
+        }
+        for (size_t i = 0; i < results.size(); ++i) {
+            REQUIRE(results[i].get() == i * i);
+        }
+    }
+}
+
+TEST_CASE("FinishesTasksOnDestruction") {
+    std::atomic<size_t> done = 0;
+    {
+        ThreadPool pool(3);
+        for (size_t i = 0; i < 100; ++i) {
+            pool.Submit([&done]() { ++done; });
+        }
+    }
+    REQUIRE(done == 100);
+}
+
+TEST_CASE("PropagatesExceptions") {
+    ThreadPool pool(2);
+    auto result = pool.Submit([]() -> int { throw std::runtime_error("task failed"); });
+    REQUIRE_THROWS_AS(result.get(), std::runtime_error);
+}
@@ -37,4 +37,38 @@ TEST_CASE("NotFound") {
     REQUIRE(trie.TraverseOnce(get_next) == nullptr);
 
     REQUIRE(trie.Traverse(std::begin(path), std::end(path)) == std::vector<size_t>{3, 5});
-}
\ No newline at end of file
+}
+TEST_CASE("MergeTerminals") {
+    Trie<size_t, 4> first;
+    first.Insert(std::vector<size_t>{1, 2}, 1);
+    first.Insert(std::vector<size_t>{0}, 2);
+    Trie<size_t, 4> second;
+    second.Insert(std::vector<size_t>{3}, 3);
+    second.Insert(std::vector<size_t>{3}, 4);
+
+    auto trie = Trie<size_t, 4>::Merge(first, second);
+    REQUIRE(trie.GetNumberOfTerminals() == 3);
+    REQUIRE(first.GetNumberOfTerminals() == 0);
+    REQUIRE(first.GetTerminals().empty());
+    using VertexPath = std::pair<std::vector<size_t>, size_t>;
+    REQUIRE(trie.GetTerminals() ==
+            std::vector<VertexPath>{{{0, 0}, 2}, {{0, 1, 2}, 1}, {{1, 3}, 4}});
+
+    const std::vector<size_t> path = {0, 1, 2, 1, 3, 0, 0};
+    REQUIRE(trie.Traverse(path.begin(), path.end()) == std::vector<size_t>{1, 4, 2});
+}
+
+TEST_CASE("DeepPath") {
+    const size_t depth = 1'000'000;
+    Trie<size_t, 2> trie;
+    std::vector<size_t> path(depth, 1);
+    path.back() = 0;
+    trie.Insert(path, 7);
+
+    REQUIRE(trie.Traverse(path.begin(), path.end()) == std::vector<size_t>{7});
+    const auto terminals = trie.GetTerminals();
+    REQUIRE(terminals.size() == 1);
+    REQUIRE(terminals[0].first == path);
+    path.back() = 1;
+    REQUIRE(trie.TraverseOnce(path.begin(), path.end()).first == nullptr);
+}
@@ -0,0 +1,27 @@
+#include <catch.hpp>
+
+#include "../src/lib/xxhash64.h"
+
+#include <random>
+#include <string>
+#include <unordered_set>
+
+TEST_CASE("KnownHashes") {
+    REQUIRE(Xxh64(nullptr, 0) == 0xEF46DB3751D8E999ull);
+    REQUIRE(Xxh64("a", 1) == 0xD24EC4F1A98C6E5Bull);
+    REQUIRE(Xxh64("abc", 3) == 0x44BC2CF5AD770999ull);
+}
+
+TEST_CASE("EveryTailLength") {
+    std::mt19937 generator(13);
+    std::string data(100, 0);
+    for (char &value : data) {
+        value = static_cast<char>(generator());
+    }
+    std::unordered_set<uint64_t> hashes;
+    for (size_t size = 0; size <= data.size(); ++size) {
+        hashes.insert(Xxh64(data.data(), size));
+        REQUIRE(Xxh64(data.data(), size) != Xxh64(data.data(), size, 1));
+    }
+    REQUIRE(hashes.size() == data.size() + 1);
+}
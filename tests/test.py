@@ -1,4 +1,5 @@
 import filecmp
+import json
 import os
 import shutil
 import sys
@@ -27,6 +28,39 @@ class ArchiverTester:
     class TestCaseFailedException(Exception):
         pass
 
+    # Compression options that are only checked to round-trip, their archives are not compared
+    ROUND_TRIP_OPTIONS = [
+        (["--max-code-len", "9"], []),
+        (["--block-size", "64"], []),
+        (["--block-size", "1024", "--max-code-len", "11"], []),
+        (["--block-size", "16", "-j", "4"], []),
+        (["--block-size", "16"], ["-j", "4"]),
+        (["-j", "2"], ["-j", "2"]),
+        (["--block-size", "16", "--streams", "4"], []),
+        (["--streams", "4", "-j", "2"], ["-j", "2"]),
+        (["--entropy", "tans"], []),
+        (["--block-size", "16", "--entropy", "tans", "-j", "2"], ["-j", "2"]),
+        (["--block-size", "16", "--entropy", "smallest", "--streams", "4"], []),
+        (["--lz", "16"], []),
+        (["--block-size", "16", "--lz", "1", "-j", "2"], ["-j", "2"]),
+        (["--lz", "64", "--entropy", "smallest"], []),
+        (["--block-size", "1"], ["-j", "2"]),
+        (["--buffer-size", "1"], ["--buffer-size", "1"]),
+        (["--block-size", "16", "--buffer-size", "1"], ["--buffer-size", "1", "-j", "2"]),
+    ]
+
+    # Compression options that must not change the archive
+    SAME_ARCHIVE_OPTIONS = [
+        ["-j", "3"],
+        ["--buffer-size", "1"],
+    ]
+
+    # Compression options of archives that are listed and extracted from
+    EXTRACT_OPTIONS = [
+        [],
+        ["--block-size", "64"],
+    ]
+
     def __init__(self, archiver_executable, test_data_dir):
         self.archiver_executable = archiver_executable
         self.test_data_dir = test_data_dir
@@ -48,33 +82,322 @@ class ArchiverTester:
         files = os.listdir(self.test_data_dir)
         for name in files:
             if os.path.isdir(self.get_test_case_data_dir(name)):
+                for options in [[]] + self.SAME_ARCHIVE_OPTIONS:
+                    try:
+                        tester.test_compression_decompression(name, options)
+                    except ArchiverTester.TestCaseFailedException:
+                        all_ok = False
+                for options, decompress_options in self.ROUND_TRIP_OPTIONS:
+                    try:
+                        tester.test_round_trip(name, options, decompress_options)
+                    except ArchiverTester.TestCaseFailedException:
+                        all_ok = False
+                try:
+                    tester.test_streaming(name)
+                except ArchiverTester.TestCaseFailedException:
+                    all_ok = False
+                try:
+                    tester.test_deduplication(name)
+                except ArchiverTester.TestCaseFailedException:
+                    all_ok = False
+                for options in self.EXTRACT_OPTIONS:
+                    try:
+                        tester.test_list_extract(name, options)
+                    except ArchiverTester.TestCaseFailedException:
+                        all_ok = False
+                try:
+                    tester.test_dictionary(name)
+                except ArchiverTester.TestCaseFailedException:
+                    all_ok = False
                 try:
-                    tester.test_compression_decompression(name)
+                    tester.test_stats(name)
+                except ArchiverTester.TestCaseFailedException:
+                    all_ok = False
+                try:
+                    tester.test_damaged_block(name)
+                except ArchiverTester.TestCaseFailedException:
+                    all_ok = False
+                try:
+                    tester.test_missing_directory(name)
                 except ArchiverTester.TestCaseFailedException:
                     all_ok = False
         return all_ok
 
-    def test_compression_decompression(self, name):
+    def test_compression_decompression(self, name, options):
+        test_name = " ".join([name] + options)
         try:
             test_case_data_dir = self.get_test_case_data_dir(name)
             test_case_archive = self.get_test_case_data_dir(name + ".arc")
             input_files = sorted(os.listdir(test_case_data_dir))
 
             with tempfile.NamedTemporaryFile() as output_file:
-                subprocess.check_call([self.archiver_executable, "-c", output_file.name] + input_files, cwd=test_case_data_dir)
+                subprocess.check_call([self.archiver_executable, "-c", output_file.name] + input_files + options,
+                                      cwd=test_case_data_dir)
 
                 if not filecmp.cmp(test_case_archive, output_file.name, shallow=False):
-                    self.fail_test_case(name, "compressed file differs from expected")
+                    self.fail_test_case(test_name, "compressed file differs from expected")
 
                 with tempfile.TemporaryDirectory() as output_dir:
                     subprocess.check_call([self.archiver_executable, "-d", output_file.name], cwd=output_dir)
 
                     if not are_dir_trees_equal(test_case_data_dir, output_dir):
-                        self.fail_test_case(name, "decompressed files differ from expected")
+                        self.fail_test_case(test_name, "decompressed files differ from expected")
+
+            self.succeed_test_case(test_name)
+        except subprocess.CalledProcessError:
+            self.fail_test_case(test_name, "archiver finished with non-zero exit code")
+
+    def test_round_trip(self, name, options, decompress_options):
+        test_name = " ".join([name] + options + ["-d"] + decompress_options)
+        try:
+            test_case_data_dir = self.get_test_case_data_dir(name)
+            input_files = sorted(os.listdir(test_case_data_dir))
+
+            with tempfile.NamedTemporaryFile() as output_file:
+                subprocess.check_call([self.archiver_executable, "-c", output_file.name] + input_files + options,
+                                      cwd=test_case_data_dir)
+
+                with tempfile.TemporaryDirectory() as output_dir:
+                    subprocess.check_call([self.archiver_executable, "-d", output_file.name] + decompress_options,
+                                          cwd=output_dir)
+
+                    if not are_dir_trees_equal(test_case_data_dir, output_dir):
+                        self.fail_test_case(test_name, "decompressed files differ from expected")
+
+            self.succeed_test_case(test_name)
+        except subprocess.CalledProcessError:
+            self.fail_test_case(test_name, "archiver finished with non-zero exit code")
+
+    def test_list_extract(self, name, options):
+        test_name = " ".join([name] + options + ["-t", "-l", "-x"])
+        try:
+            test_case_data_dir = self.get_test_case_data_dir(name)
+            input_files = sorted(os.listdir(test_case_data_dir))
+
+            with tempfile.NamedTemporaryFile() as output_file:
+                subprocess.check_call([self.archiver_executable, "-c", output_file.name] + input_files + options,
+                                      cwd=test_case_data_dir)
+
+                subprocess.check_call([self.archiver_executable, "-t", output_file.name])
+
+                listing = subprocess.check_output([self.archiver_executable, "-l", output_file.name]).decode()
+                expected_listing = "".join(
+                    "{size}\t{name}\n".format(size=os.path.getsize(os.path.join(test_case_data_dir, file_name)),
+                                               name=file_name) for file_name in input_files)
+                if listing != expected_listing:
+                    self.fail_test_case(test_name, "listed files differ from expected")
+
+                extracted_file = input_files[-1]
+                with tempfile.TemporaryDirectory() as output_dir:
+                    subprocess.check_call([self.archiver_executable, "-x", output_file.name, extracted_file],
+                                          cwd=output_dir)
+
+                    if os.listdir(output_dir) != [extracted_file] or not filecmp.cmp(
+                            os.path.join(test_case_data_dir, extracted_file), os.path.join(output_dir, extracted_file),
+                            shallow=False):
+                        self.fail_test_case(test_name, "extracted file differs from expected")
+
+            self.succeed_test_case(test_name)
+        except subprocess.CalledProcessError:
+            self.fail_test_case(test_name, "archiver finished with non-zero exit code")
+
+    def test_streaming(self, name):
+        test_name = " ".join([name, "-c - -d - -"])
+        try:
+            test_case_data_dir = self.get_test_case_data_dir(name)
+            test_case_archive = self.get_test_case_data_dir(name + ".arc")
+            input_files = sorted(os.listdir(test_case_data_dir))
+            contents = b""
+            for file_name in input_files:
+                with open(os.path.join(test_case_data_dir, file_name), "rb") as input_file:
+                    contents += input_file.read()
+            with open(test_case_archive, "rb") as archive_file:
+                expected_archive = archive_file.read()
+
+            archive = subprocess.check_output([self.archiver_executable, "-c", "-"] + input_files,
+                                              cwd=test_case_data_dir)
+            if archive != expected_archive:
+                self.fail_test_case(test_name, "compressed stream differs from expected")
+
+            decompressed = subprocess.run([self.archiver_executable, "-d", "-", "-"], input=archive,
+                                          stdout=subprocess.PIPE, check=True).stdout
+            if decompressed != contents:
+                self.fail_test_case(test_name, "decompressed stream differs from expected")
+
+            archive = subprocess.run([self.archiver_executable, "-c", "-", "-"], input=contents,
+                                     stdout=subprocess.PIPE, check=True).stdout
+            decompressed = subprocess.run([self.archiver_executable, "-d", "-", "-"], input=archive,
+                                          stdout=subprocess.PIPE, check=True).stdout
+            if decompressed != contents:
+                self.fail_test_case(test_name, "standard input differs after round trip")
+
+            self.succeed_test_case(test_name)
+        except subprocess.CalledProcessError:
+            self.fail_test_case(test_name, "archiver finished with non-zero exit code")
+
+    def test_deduplication(self, name):
+        test_name = " ".join([name, "--dedup"])
+        try:
+            test_case_data_dir = self.get_test_case_data_dir(name)
+            with tempfile.TemporaryDirectory() as input_dir:
+                input_files = []
+                for file_name in sorted(os.listdir(test_case_data_dir)):
+                    shutil.copy(os.path.join(test_case_data_dir, file_name), os.path.join(input_dir, file_name))
+                    shutil.copy(os.path.join(test_case_data_dir, file_name), os.path.join(input_dir, "copy_" + file_name))
+                    input_files += [file_name, "copy_" + file_name]
+
+                with tempfile.NamedTemporaryFile() as output_file, tempfile.NamedTemporaryFile() as plain_file:
+                    subprocess.check_call([self.archiver_executable, "-c", output_file.name] + input_files + ["--dedup"],
+                                          cwd=input_dir)
+                    subprocess.check_call([self.archiver_executable, "-c", plain_file.name] + input_files +
+                                          ["--block-size", "1024"], cwd=input_dir)
+                    data_size = sum(os.path.getsize(os.path.join(input_dir, file_name)) for file_name in input_files)
+                    if data_size > 0 and os.path.getsize(output_file.name) >= os.path.getsize(plain_file.name):
+                        self.fail_test_case(test_name, "copies are not smaller than compressed files")
+
+                    with tempfile.TemporaryDirectory() as output_dir:
+                        subprocess.check_call([self.archiver_executable, "-d", output_file.name], cwd=output_dir)
+                        if not are_dir_trees_equal(input_dir, output_dir):
+                            self.fail_test_case(test_name, "decompressed files differ from expected")
+
+                    with tempfile.TemporaryDirectory() as output_dir:
+                        subprocess.check_call([self.archiver_executable, "-x", output_file.name, input_files[-1]],
+                                              cwd=output_dir)
+                        if os.listdir(output_dir) != [input_files[-1]] or not filecmp.cmp(
+                                os.path.join(input_dir, input_files[-1]), os.path.join(output_dir, input_files[-1]),
+                                shallow=False):
+                            self.fail_test_case(test_name, "extracted copy differs from expected")
+
+                    contents = b""
+                    for file_name in input_files:
+                        with open(os.path.join(input_dir, file_name), "rb") as input_file:
+                            contents += input_file.read()
+                    decompressed = subprocess.check_output([self.archiver_executable, "-d", output_file.name, "-"])
+                    if decompressed != contents:
+                        self.fail_test_case(test_name, "decompressed stream differs from expected")
+
+            self.succeed_test_case(test_name)
+        except subprocess.CalledProcessError:
+            self.fail_test_case(test_name, "archiver finished with non-zero exit code")
+
+    def test_dictionary(self, name):
+        test_name = " ".join([name, "-T", "--dictionary", "--link-dictionary"])
+        try:
+            test_case_data_dir = self.get_test_case_data_dir(name)
+            input_files = sorted(os.listdir(test_case_data_dir))
+
+            with tempfile.NamedTemporaryFile() as dictionary_file, tempfile.NamedTemporaryFile() as output_file:
+                subprocess.check_call([self.archiver_executable, "-T", dictionary_file.name] + input_files,
+                                      cwd=test_case_data_dir)
+                for options in [[], ["--link-dictionary", "--block-size", "1"]]:
+                    subprocess.check_call([self.archiver_executable, "-c", output_file.name] + input_files +
+                                          ["--dictionary", dictionary_file.name] + options, cwd=test_case_data_dir)
+
+                    with tempfile.TemporaryDirectory() as output_dir:
+                        if options and subprocess.call([self.archiver_executable, "-d", output_file.name],
+                                                       cwd=output_dir, stderr=subprocess.DEVNULL) == 0:
+                            self.fail_test_case(test_name, "linked archive was decompressed without its dictionary")
+                        subprocess.check_call([self.archiver_executable, "-d", output_file.name, "--dictionary",
+                                               dictionary_file.name], cwd=output_dir)
+                        if not are_dir_trees_equal(test_case_data_dir, output_dir):
+                            self.fail_test_case(test_name, "decompressed files differ from expected")
+
+                    subprocess.check_call([self.archiver_executable, "-l", output_file.name], stdout=subprocess.DEVNULL)
+
+            self.succeed_test_case(test_name)
+        except subprocess.CalledProcessError:
+            self.fail_test_case(test_name, "archiver finished with non-zero exit code")
+
+    def test_stats(self, name):
+        test_name = " ".join([name, "--stats json"])
+        try:
+            test_case_data_dir = self.get_test_case_data_dir(name)
+            input_files = sorted(os.listdir(test_case_data_dir))
+            data_size = sum(os.path.getsize(os.path.join(test_case_data_dir, file_name)) for file_name in input_files)
+
+            with tempfile.NamedTemporaryFile() as output_file:
+                for options in [[], ["--block-size", "64", "-j", "2"]]:
+                    report = subprocess.run([self.archiver_executable, "-c", output_file.name] + input_files +
+                                            options + ["--stats", "json"], cwd=test_case_data_dir,
+                                            stderr=subprocess.PIPE, check=True).stderr
+                    stats = json.loads(report)
+                    if [file["name"] for file in stats["files"]] != input_files:
+                        self.fail_test_case(test_name, "files in stats differ from expected")
+                    if stats["total"]["raw_bytes"] != data_size or \
+                            stats["total"]["archive_bytes"] != os.path.getsize(output_file.name):
+                        self.fail_test_case(test_name, "sizes in stats differ from expected")
+
+            self.succeed_test_case(test_name)
+        except subprocess.CalledProcessError:
+            self.fail_test_case(test_name, "archiver finished with non-zero exit code")
+        except ValueError:
+            self.fail_test_case(test_name, "stats are not valid JSON")
+
+    def test_damaged_block(self, name):
+        test_name = " ".join([name, "--block-size 64", "damaged", "-t", "-d"])
+        try:
+            test_case_data_dir = self.get_test_case_data_dir(name)
+            input_files = sorted(os.listdir(test_case_data_dir))
+            first_file = next((file_name for file_name in input_files
+                               if os.path.getsize(os.path.join(test_case_data_dir, file_name)) > 0), None)
+            if first_file is None:
+                self.succeed_test_case(test_name)
+                return
+
+            with tempfile.NamedTemporaryFile() as output_file:
+                subprocess.check_call([self.archiver_executable, "-c", output_file.name, first_file, "--block-size", "64"],
+                                      cwd=test_case_data_dir)
+                with open(output_file.name, "rb") as archive_file:
+                    archive = bytearray(archive_file.read())
+                # Archive header, member header and block header come before the first payload byte
+                archive[(4 + 1 + 4 + 1) + (1 + 2 + len(first_file.encode())) + (1 + 4 + 4 + 4)] ^= 0x01
+                with open(output_file.name, "wb") as archive_file:
+                    archive_file.write(archive)
+
+                if subprocess.call([self.archiver_executable, "-t", output_file.name],
+                                   stderr=subprocess.DEVNULL) == 0:
+                    self.fail_test_case(test_name, "damaged archive passed the test")
+                with tempfile.NamedTemporaryFile() as truncated_file:
+                    truncated_file.write(archive[:len(archive) // 2])
+                    truncated_file.flush()
+                    report = subprocess.run([self.archiver_executable, "-t", truncated_file.name],
+                                            stderr=subprocess.PIPE)
+                    if report.returncode == 0 or b"Archive is damaged" not in report.stderr:
+                        self.fail_test_case(test_name, "truncated archive is not reported as damaged")
+                with tempfile.TemporaryDirectory() as output_dir:
+                    if subprocess.call([self.archiver_executable, "-d", output_file.name], cwd=output_dir,
+                                       stderr=subprocess.DEVNULL) == 0:
+                        self.fail_test_case(test_name, "damaged archive was decompressed")
+
+            self.succeed_test_case(test_name)
+        except subprocess.CalledProcessError:
+            self.fail_test_case(test_name, "archiver finished with non-zero exit code")
+
+    def test_missing_directory(self, name):
+        test_name = " ".join([name, "missing directory", "-d", "-x"])
+        try:
+            test_case_data_dir = self.get_test_case_data_dir(name)
+            with tempfile.TemporaryDirectory() as input_dir:
+                input_files = []
+                os.mkdir(os.path.join(input_dir, "sub"))
+                for file_name in sorted(os.listdir(test_case_data_dir)):
+                    shutil.copy(os.path.join(test_case_data_dir, file_name), os.path.join(input_dir, "sub", file_name))
+                    input_files.append(os.path.join("sub", file_name))
+
+                with tempfile.NamedTemporaryFile() as output_file:
+                    subprocess.check_call([self.archiver_executable, "-c", output_file.name] + input_files +
+                                          ["--block-size", "64"], cwd=input_dir)
+                    # The member files cannot be created without their directory
+                    for arguments in [["-d", output_file.name], ["-d", output_file.name, "-j", "4"],
+                                      ["-x", output_file.name, input_files[-1]]]:
+                        with tempfile.TemporaryDirectory() as output_dir:
+                            if subprocess.call([self.archiver_executable] + arguments, cwd=output_dir,
+                                               stderr=subprocess.DEVNULL) != 111:
+                                self.fail_test_case(test_name, "archiver did not fail with its error code")
 
-            self.succeed_test_case(name)
+            self.succeed_test_case(test_name)
         except subprocess.CalledProcessError:
-            self.fail_test_case(name, "archiver finished with non-zero exit code")
+            self.fail_test_case(test_name, "archiver finished with non-zero exit code")
 
 
 if __name__ == "__main__":